@@ -1,4 +1,8 @@
 #include "archetype.h"
+#include "registry.h"
+
+#include <algorithm>
+#include <bit>
 
 namespace Vivium {
 	namespace ECS {
@@ -10,32 +14,238 @@ namespace Vivium {
 			return signature != other.signature;
 		}
 
-		void archetype_t::m_clear() {
+		void archetype_t::m_set_signature(const signature_t& new_signature, const signature_t& tags) {
+			signature = new_signature;
+
+			component_ids.clear();
+
 			for (uint32_t i = 0; i < MAX_COMPONENTS; i++) {
-				if (signature.enabled.test(i)) {
-					arrays[i].components.clear();
-				}
+				if (signature.enabled.test(i) && !tags.enabled.test(i))
+					component_ids.push_back(static_cast<component_id_t>(i));
+			}
+		}
+
+		void archetype_t::m_clear() {
+			for (component_id_t i : component_ids) {
+				arrays[i].components.clear();
 			}
 
+			entities.clear();
+			enabled_rows.clear();
+			disabled_count = 0;
 			size = 0;
 		}
 
-		void archetype_t::remove_entity(entity_t& entity) {
-			// Iterate enabled arrays
-			for (uint32_t i = 0; i < MAX_COMPONENTS; i++) {
-				if (signature.enabled.test(i)) {
-					component_array_t& components = arrays[i].components;
+		entity_value_t archetype_t::m_remove_row(uint32_t index) {
+			entity_value_t moved = ENTITY_NULL;
+			uint32_t last = static_cast<uint32_t>(entities.size() - 1);
+
+			if (!is_row_enabled(index))
+				--disabled_count;
+
+			if (index != last) {
+				moved = entities.back();
+				entities[index] = moved;
+
+				m_set_row_bit(index, is_row_enabled(last));
+			}
+
+			m_set_row_bit(last, false);
+			entities.pop_back();
+
+			if (last % 64 == 0)
+				enabled_rows.pop_back();
+
+			return moved;
+		}
+
+		void archetype_t::m_push_row(entity_value_t entity, bool enabled) {
+			uint32_t row = static_cast<uint32_t>(entities.size());
+
+			entities.push_back(entity);
+
+			if (row % 64 == 0)
+				enabled_rows.push_back(0);
+
+			m_set_row_bit(row, enabled);
+
+			if (!enabled)
+				++disabled_count;
+		}
+
+		void archetype_t::m_resize_rows(uint32_t count) {
+			uint32_t old_count = static_cast<uint32_t>(entities.size());
+
+			entities.resize(count);
+			enabled_rows.resize((count + 63) / 64, 0);
+
+			for (uint32_t row = old_count; row < count; row++) {
+				m_set_row_bit(row, true);
+			}
+
+			// Bits past the last row stay clear, so scans can stop at the first set bit
+			if (count % 64 != 0)
+				enabled_rows.back() &= (uint64_t(1) << (count % 64)) - 1;
+
+			uint32_t enabled_count = 0;
+
+			for (uint64_t word : enabled_rows) {
+				enabled_count += std::popcount(word);
+			}
+
+			disabled_count = count - enabled_count;
+		}
+
+		void archetype_t::m_set_row_bit(uint32_t row, bool enabled) {
+			uint64_t mask = uint64_t(1) << (row & 63);
+
+			if (enabled)
+				enabled_rows[row >> 6] |= mask;
+			else
+				enabled_rows[row >> 6] &= ~mask;
+		}
+
+		void archetype_t::set_row_enabled(uint32_t row, bool enabled) {
+			if (is_row_enabled(row) == enabled) return;
+
+			m_set_row_bit(row, enabled);
+
+			if (enabled)
+				--disabled_count;
+			else
+				++disabled_count;
+		}
+
+		uint32_t archetype_t::next_enabled_row(uint32_t row) const {
+			uint32_t count = static_cast<uint32_t>(entities.size());
+
+			while (row < count) {
+				uint64_t word = enabled_rows[row >> 6] >> (row & 63);
+
+				if (word != 0)
+					return std::min(row + static_cast<uint32_t>(std::countr_zero(word)), count);
+
+				row = (row | 63) + 1;
+			}
+
+			return count;
+		}
+
+		uint32_t archetype_t::next_disabled_row(uint32_t row) const {
+			uint32_t count = static_cast<uint32_t>(entities.size());
+
+			while (row < count) {
+				uint64_t word = ~enabled_rows[row >> 6] >> (row & 63);
+
+				if (word != 0)
+					return std::min(row + static_cast<uint32_t>(std::countr_zero(word)), count);
 
-					// Swap remove this entity from that array
-					components.erase(entity.index);
+				row = (row | 63) + 1;
+			}
+
+			return count;
+		}
+
+		void archetype_t::m_transfer_rows(const uint32_t* rows, uint32_t count, archetype_t& destination, registry_t& registry) {
+			if (count == 0) return;
+
+			for (component_id_t i : component_ids) {
+				arrays[i].components.transfer_rows_to_end_of(rows, count, destination.arrays[i].components);
+			}
+
+			// Moved entities follow the destination's existing rows, in the order given
+			for (uint32_t i = 0; i < count; i++) {
+				entity_t& entity = registry.m_entity_sparse.at(entities[rows[i]]);
+
+				entity.archetype = &destination;
+				entity.index = destination.size + i;
+
+				destination.m_push_row(entity.value, is_row_enabled(rows[i]));
+			}
+
+			destination.size += count;
+
+			// Fill gaps the same way the columns did
+			uint32_t new_size = size - count;
+			uint32_t tail = new_size;
+			uint32_t next_moved = static_cast<uint32_t>(std::lower_bound(rows, rows + count, new_size) - rows);
+
+			for (uint32_t i = 0; i < count && rows[i] < new_size; i++) {
+				while (next_moved < count && rows[next_moved] == tail) {
+					++tail;
+					++next_moved;
 				}
+
+				m_set_row_bit(rows[i], is_row_enabled(tail));
+				entities[rows[i]] = entities[tail++];
+				registry.m_set_entity_index(entities[rows[i]], rows[i]);
+			}
+
+			m_resize_rows(new_size);
+			size = new_size;
+		}
+
+		void archetype_t::m_reorder_rows(const uint32_t* order, registry_t& registry) {
+			for (component_id_t i : component_ids) {
+				arrays[i].components.reorder(order);
+			}
+
+			std::vector<entity_value_t> old_entities = entities;
+			std::vector<uint64_t> old_enabled_rows = enabled_rows;
+
+			for (uint32_t row = 0; row < size; row++) {
+				uint32_t old_row = order[row];
+
+				if (old_row == row) continue;
+
+				entities[row] = old_entities[old_row];
+				m_set_row_bit(row, (old_enabled_rows[old_row >> 6] >> (old_row & 63)) & 1);
+
+				registry.m_set_entity_index(entities[row], row);
+			}
+		}
+
+		void archetype_t::shrink_to_fit() {
+			for (component_id_t i : component_ids) {
+				arrays[i].components.shrink_to_fit();
 			}
 
+			component_ids.shrink_to_fit();
+			entities.shrink_to_fit();
+			enabled_rows.shrink_to_fit();
+		}
+
+		size_t archetype_t::memory_usage() const {
+			size_t bytes = sizeof(archetype_t)
+				+ component_ids.capacity() * sizeof(component_id_t)
+				+ entities.capacity() * sizeof(entity_value_t)
+				+ enabled_rows.capacity() * sizeof(uint64_t);
+
+			for (component_id_t i : component_ids) {
+				bytes += arrays[i].components.memory_usage();
+			}
+
+			return bytes;
+		}
+
+		entity_value_t archetype_t::remove_entity(entity_t& entity) {
+			// Iterate enabled arrays
+			for (component_id_t i : component_ids) {
+				component_array_t& components = arrays[i].components;
+
+				// Swap remove this entity from that array
+				components.erase(entity.index);
+			}
+
+			entity_value_t moved = m_remove_row(entity.index);
+
 			// Update this entity's data
 			entity.index = INVALID_INDEX;
 			entity.archetype = nullptr;
 
 			--size;
+
+			return moved;
 		}
 	}
 }
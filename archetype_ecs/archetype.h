@@ -2,16 +2,20 @@
 
 #include "signature.h"
 #include "component.h"
+#include "sparse_pool.h"
 #include "entity.h"
 
 #include <array>
 #include <memory>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 namespace Vivium {
 	namespace ECS {
 		struct archetype_t;
 		struct registry_t;
+		struct rollback_buffer_t;
 
 		struct archetype_connections_t {
 			archetype_t* add = nullptr;
@@ -24,7 +28,33 @@ namespace Vivium {
 			// so this doesn't matter
 			void m_clear();
 
+			// Set signature and the list of enabled component ids, excluding tags
+			void m_set_signature(const signature_t& new_signature, const signature_t& tags);
+
+			// Swap remove row from entity list and enabled bits, returns the entity
+			// that was moved into that row, or ENTITY_NULL if it was the last row
+			entity_value_t m_remove_row(uint32_t index);
+
+			// Append row for entity, keeping enabled bits in step with entities
+			void m_push_row(entity_value_t entity, bool enabled);
+			// Resize entity list, new rows are enabled
+			void m_resize_rows(uint32_t count);
+			// Set enabled bit without updating disabled_count
+			void m_set_row_bit(uint32_t row, bool enabled);
+
+			// Rearrange rows so row order[i] ends up at i, updating entity indices
+			void m_reorder_rows(const uint32_t* order, registry_t& registry);
+
+			// Archetype with the component added, found through the add connection if possible
+			template <typename T>
+			archetype_t* m_get_add_archetype(registry_t& registry, component_id_t component_id);
+
+			// Move rows, sorted ascending without duplicates, to the end of destination, which
+			// must have every component we have. Columns only destination has are left alone
+			void m_transfer_rows(const uint32_t* rows, uint32_t count, archetype_t& destination, registry_t& registry);
+
 			friend registry_t;
+			friend rollback_buffer_t;
 
 		public:
 			// Data stored per component in an archetype
@@ -37,7 +67,17 @@ namespace Vivium {
 			struct iterator;
 
 			signature_t signature;
+			// Enabled component ids ascending, so moving a row only touches the columns
+			// it has. Columns share ids between archetypes, so graph edges need no mapping.
+			// Tags are in the signature but have no column, so aren't listed
+			std::vector<component_id_t> component_ids;
 			std::array<per_component_data_t, MAX_COMPONENTS> arrays;
+			// Entity stored in each row
+			std::vector<entity_value_t> entities;
+			// Bit per row, set if the row is enabled. Disabled rows keep their place in
+			// every column, but are skipped by iteration
+			std::vector<uint64_t> enabled_rows;
+			uint32_t disabled_count = 0;
 			uint32_t size = 0;
 
 			archetype_t() = default;
@@ -45,16 +85,17 @@ namespace Vivium {
 			bool operator==(const archetype_t& other) const;
 			bool operator!=(const archetype_t& other) const;
 
+			// Pools are required when iterating sparse components
 			template <typename... Ts>
-			iterator<Ts...> begin(registry_id_t registry);
+			iterator<Ts...> begin(registry_id_t registry, sparse_pools_t* pools = nullptr);
 			template <typename... Ts>
-			iterator<Ts...> end(registry_id_t registry);
+			iterator<Ts...> end(registry_id_t registry, sparse_pools_t* pools = nullptr);
 
 			// Setup without knowing signature
 			template <typename... Ts>
 			void setup(registry_id_t registry) {
 				signature_t _signature;
-				_signature.setup<Ts>(registry);
+				_signature.setup<Ts...>(registry);
 				
 				setup<Ts...>(registry, _signature);
 			}
@@ -62,37 +103,84 @@ namespace Vivium {
 			// Setup if signature already known/computed
 			template <typename... Ts>
 			void setup(registry_id_t registry, signature_t _signature) {
-				signature = _signature;
+				signature_t tags;
 
 				([&]() {
 					component_id_t component_id = component_registry<Ts>::get_id(registry);
 
-					arrays[component_id].components.setup<Ts>();
+					if constexpr (is_tag_v<Ts>)
+						tags.enabled.set(component_id, true);
+					else
+						arrays[component_id].components.setup<Ts>();
 				}(), ...);
+
+				m_set_signature(_signature, tags);
+			}
+
+			// Returns the entity that was moved into the removed row, or ENTITY_NULL
+			[[nodiscard]] entity_value_t remove_entity(entity_t& entity);
+
+			// Release capacity of columns and row data beyond the current rows
+			void shrink_to_fit();
+
+			// Bytes held by the archetype, including capacity not yet used
+			size_t memory_usage() const;
+
+			bool is_row_enabled(uint32_t row) const {
+				return (enabled_rows[row >> 6] >> (row & 63)) & 1;
 			}
 
-			void remove_entity(entity_t& entity);
+			void set_row_enabled(uint32_t row, bool enabled);
+
+			// First enabled row at or after row, or the amount of rows if there are none.
+			// Together with next_disabled_row, splits rows into dense runs of enabled rows
+			uint32_t next_enabled_row(uint32_t row) const;
+			// First disabled row at or after row, or the amount of rows if there are none
+			uint32_t next_disabled_row(uint32_t row) const;
 			
-			template <typename... component_ts>
-			void push_entity(entity_t& entity, registry_id_t registry, const component_ts&... components) {
+			// Each component is constructed in its column from the matching argument,
+			// so rvalues are moved in rather than copied
+			template <typename... component_ts, typename... Args>
+			void push_entity(entity_t& entity, registry_id_t registry, Args&&... components) {
+				static_assert(sizeof...(component_ts) == sizeof...(Args), "Expected one argument per component");
+
 				if (sizeof...(components) == 0) {
 					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to push entity with 0 components");
 				}
 				
 				([&]() {
-					component_id_t component_id = component_registry<component_ts>::get_id(registry);
-					arrays[component_id].components.push_back(components);
+					if constexpr (!is_tag_v<component_ts>) {
+						component_id_t component_id = component_registry<component_ts>::get_id(registry);
+						arrays[component_id].components.emplace_back<component_ts>(std::forward<Args>(components));
+					}
 				}(), ...);
 
+				m_push_row(entity.value, true);
+
 				entity.index = size++;
 				entity.archetype = this;
 			}
 
-			template <typename T>
-			void push_component(entity_t& entity, registry_t& registry, const T& component);
+			// Push entity to an archetype with only T, constructed from args in the column
+			template <typename T, typename... Args>
+			void emplace_entity(entity_t& entity, registry_id_t registry, Args&&... args) {
+				if constexpr (!is_tag_v<T>) {
+					component_id_t component_id = component_registry<T>::get_id(registry);
+					arrays[component_id].components.emplace_back<T>(std::forward<Args>(args)...);
+				}
+
+				m_push_row(entity.value, true);
+
+				entity.index = size++;
+				entity.archetype = this;
+			}
+
+			// Construct T from args directly in the destination column
+			template <typename T, typename... Args>
+			void emplace_component(entity_t& entity, registry_t& registry, Args&&... args);
 		
-			template <typename... Ts>
-			void push_components(entity_t& entity, registry_t& registry, const Ts&... components);
+			template <typename... Ts, typename... Args>
+			void push_components(entity_t& entity, registry_t& registry, Args&&... components);
 
 			template <typename T>
 			void remove_component(entity_t& entity, registry_t& registry);
@@ -7,24 +7,19 @@
 namespace Vivium {
 	namespace ECS {
 		template <typename... Ts>
-		archetype_t::iterator<Ts...> archetype_t::begin(registry_id_t registry) { return iterator<Ts...>(this, registry, 0); }
+		archetype_t::iterator<Ts...> archetype_t::begin(registry_id_t registry, sparse_pools_t* pools) { return iterator<Ts...>(this, registry, 0, pools, true); }
 		template <typename... Ts>
-		archetype_t::iterator<Ts...> archetype_t::end(registry_id_t registry) { return iterator<Ts...>(this, registry, size); }
+		archetype_t::iterator<Ts...> archetype_t::end(registry_id_t registry, sparse_pools_t* pools) { return iterator<Ts...>(this, registry, size, pools); }
 
 		template <typename T>
-		void archetype_t::push_component(entity_t& entity, registry_t& registry, const T& component) {
-			// Calculate/find new archetype for entity
-
-			// Check if its in our add component vector
-			component_id_t new_component_id = component_registry<T>::get_id(registry.m_id);
-
-			archetype_t*& add_archetype = arrays[new_component_id].connections.add;
+		archetype_t* archetype_t::m_get_add_archetype(registry_t& registry, component_id_t component_id) {
+			archetype_t*& add_archetype = arrays[component_id].connections.add;
 
 			// We didn't already have it, so find it in registry
 			if (add_archetype == nullptr) {
 				// Calculate signature
 				signature_t new_signature = signature;
-				new_signature.enabled.set(new_component_id, true);
+				new_signature.enabled.set(component_id, true);
 
 				archetype_t* new_archetype = registry.m_get_archetype(new_signature);
 
@@ -39,27 +34,52 @@ namespace Vivium {
 				}
 			}
 
-			// add_archetype now stores the new archetype
+			return add_archetype;
+		}
+
+		template <typename T, typename... Args>
+		void archetype_t::emplace_component(entity_t& entity, registry_t& registry, Args&&... args) {
+			// Calculate/find new archetype for entity
+
+			// Check if its in our add component vector
+			component_id_t new_component_id = component_registry<T>::get_id(registry.m_id);
+
+			// Already have this component, so just replace it
+			if (signature.enabled.test(new_component_id)) {
+				VIVIUM_ECS_ERROR(severity::WARN, "Pushed component {} that entity already had", typeid(T).name());
+
+				if constexpr (!is_tag_v<T>)
+					arrays[new_component_id].components.emplace_at<T>(entity.index, std::forward<Args>(args)...);
+
+				return;
+			}
+
+			archetype_t* add_archetype = m_get_add_archetype<T>(registry, new_component_id);
+
 			// Copy old component data over, and add new component
 			// First iterate enabled component arrays
-			uint32_t array_size = 0;
-
-			for (uint32_t i = 0; i < MAX_COMPONENTS; i++) {
-				if (signature.enabled.test(i)) {
-					arrays[i].components.transfer_index_to_end_of(
-						entity.index,
-						add_archetype->arrays[i].components
-					);
+			uint32_t old_index = entity.index;
 
-					array_size = add_archetype->arrays[i].components.size();
-				}
+			for (component_id_t i : component_ids) {
+				arrays[i].components.transfer_index_to_end_of(
+					old_index,
+					add_archetype->arrays[i].components
+				);
 			}
 
 			// Adding new component
-			add_archetype->arrays[new_component_id].components.push_back(component);
+			if constexpr (!is_tag_v<T>)
+				add_archetype->arrays[new_component_id].components.emplace_back<T>(std::forward<Args>(args)...);
+
+			// Entity keeps its enabled state in the new archetype
+			bool enabled = is_row_enabled(old_index);
+
+			// Last entity in this archetype filled the row we left
+			registry.m_set_entity_index(m_remove_row(old_index), old_index);
+			add_archetype->m_push_row(entity.value, enabled);
 
 			// Update entity to point to new archetype
-			entity.index = array_size - 1;
+			entity.index = add_archetype->size;
 			entity.archetype = add_archetype;
 
 			// Decrement our size
@@ -68,11 +88,34 @@ namespace Vivium {
 			++(add_archetype->size);
 		}
 
-		template<typename ...Ts>
-		void archetype_t::push_components(entity_t& entity, registry_t& registry, const Ts&... components)
+		template <typename... Ts, typename... Args>
+		void archetype_t::push_components(entity_t& entity, registry_t& registry, Args&&... components)
 		{
+			static_assert(sizeof...(Ts) == sizeof...(Args), "Expected one argument per component");
+
+			// Components the entity already has are replaced in place, like emplace_component,
+			// and only the rest are added
+			std::array<bool, sizeof...(Ts)> present;
 			signature_t new_signature = signature;
-			new_signature.extend<Ts...>(registry.m_id);
+			uint32_t position = 0;
+
+			([&]() {
+				component_id_t component_id = component_registry<Ts>::get_id(registry.m_id);
+
+				present[position++] = signature.enabled.test(component_id);
+				new_signature.enabled.set(component_id, true);
+			}(), ...);
+
+			if (new_signature == signature) {
+				([&]() {
+					VIVIUM_ECS_ERROR(severity::WARN, "Pushed component {} that entity already had", typeid(Ts).name());
+
+					if constexpr (!is_tag_v<Ts>)
+						arrays[component_registry<Ts>::get_id(registry.m_id)].components.template emplace_at<Ts>(entity.index, std::forward<Args>(components));
+				}(), ...);
+
+				return;
+			}
 
 			archetype_t* new_archetype = registry.m_get_archetype(new_signature);
 
@@ -80,28 +123,42 @@ namespace Vivium {
 				new_archetype = registry.m_extend_archetype<Ts...>(*this);
 			}
 
-			uint32_t array_size = 0;
+			uint32_t old_index = entity.index;
 
 			// Move old components
-			for (uint32_t i = 0; i < MAX_COMPONENTS; i++) {
-				if (signature.enabled.test(i)) {
-					arrays[i].components.transfer_index_to_end_of(
-						entity.index,
-						new_archetype->arrays[i].components
-					);
-
-					array_size = new_archetype->arrays[i].components.size();
-				}
+			for (component_id_t i : component_ids) {
+				arrays[i].components.transfer_index_to_end_of(
+					old_index,
+					new_archetype->arrays[i].components
+				);
 			}
 
-			// Add new components
+			// Add new components, replacing those that were moved over
+			position = 0;
+
 			([&]() {
-				component_id_t component_id = component_registry<Ts>::get_id(registry.m_id);
+				bool replace = present[position++];
+
+				if constexpr (!is_tag_v<Ts>) {
+					component_array_t& array = new_archetype->arrays[component_registry<Ts>::get_id(registry.m_id)].components;
 
-				new_archetype->arrays[component_id].components.push_back(components);
+					if (replace)
+						array.emplace_at<Ts>(array.size() - 1, std::forward<Args>(components));
+					else
+						array.emplace_back<Ts>(std::forward<Args>(components));
+				}
+
+				if (replace)
+					VIVIUM_ECS_ERROR(severity::WARN, "Pushed component {} that entity already had", typeid(Ts).name());
 			}(), ...);
 
-			entity.index = array_size - 1;
+			// Entity keeps its enabled state in the new archetype
+			bool enabled = is_row_enabled(old_index);
+
+			registry.m_set_entity_index(m_remove_row(old_index), old_index);
+			new_archetype->m_push_row(entity.value, enabled);
+
+			entity.index = new_archetype->size;
 			entity.archetype = new_archetype;
 
 			--size;
@@ -115,6 +172,12 @@ namespace Vivium {
 
 			component_id_t new_component_id = component_registry<T>::get_id(registry.m_id);
 
+			if (!signature.enabled.test(new_component_id)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to remove component {} that entity didn't have", typeid(T).name());
+
+				return;
+			}
+
 			// Check if its in our remove component vector
 			archetype_t*& rem_archetype = arrays[new_component_id].connections.remove;
 
@@ -137,45 +200,41 @@ namespace Vivium {
 				}
 			}
 
+			uint32_t old_index = entity.index;
+
+			// Archetype is null since all components were removed, so the
+			// entity just leaves this archetype
+			if (rem_archetype == nullptr) {
+				registry.m_set_entity_index(remove_entity(entity), old_index);
+
+				return;
+			}
+
 			// rem_archetype now stores the new archetype
 			
 			// Copy old component data over, except component to be removed
 			// First iterate enabled component arrays
-			uint32_t array_size = INVALID_INDEX;
-
-			for (uint32_t i = 0; i < MAX_COMPONENTS; i++) {
-				if (signature.enabled.test(i)) {
-					// Archetype is null since all components were removed
-					if (rem_archetype == nullptr) {
-						// So just delete all the components which were
-						// enabled in the old archetype
-						arrays[new_component_id].components.erase(
-							entity.index
-						);
-					}
-					// Check if its the component to be removed
-					else if (!rem_archetype->signature.enabled.test(i)) {
-						// It was one of the components that we're removing,
-						// since its in the old archetype but not the new one
-						// So just remove that component from the array,
-						// but don't transfer it over
-						arrays[new_component_id].components.erase(
-							entity.index
-						);
-					}
-					else {
-						arrays[i].components.transfer_index_to_end_of(
-							entity.index,
-							rem_archetype->arrays[i].components
-						);
-
-						array_size = rem_archetype->arrays[i].components.size();
-					}
+			for (component_id_t i : component_ids) {
+				// Component being removed isn't transferred, just erased
+				if (i == new_component_id) {
+					arrays[i].components.erase(old_index);
+				}
+				else {
+					arrays[i].components.transfer_index_to_end_of(
+						old_index,
+						rem_archetype->arrays[i].components
+					);
 				}
 			}
 
+			// Entity keeps its enabled state in the new archetype
+			bool enabled = is_row_enabled(old_index);
+
+			registry.m_set_entity_index(m_remove_row(old_index), old_index);
+			rem_archetype->m_push_row(entity.value, enabled);
+
 			// Update entity to point to new archetype
-			entity.index = array_size - 1;
+			entity.index = rem_archetype->size;
 			entity.archetype = rem_archetype;
 
 			// Decrement our size
@@ -189,7 +248,14 @@ namespace Vivium {
 		{
 			component_id_t component_id = component_registry<T>::get_id(registry);
 
-			return arrays[component_id].components.at<T>(entity.index);
+			if constexpr (is_tag_v<T>) {
+				VIVIUM_ECS_CHECK(signature.enabled.test(component_id), severity::ERROR, "Attempted to get tag {} that entity didn't have", typeid(T).name());
+
+				return tag_instance<T>();
+			}
+			else {
+				return arrays[component_id].components.at<T>(entity.index);
+			}
 		}
 
 		template <typename T>
@@ -197,7 +263,14 @@ namespace Vivium {
 		{
 			component_id_t component_id = component_registry<T>::get_id(registry);
 
-			return arrays[component_id].components.at<T>(entity.index);
+			if constexpr (is_tag_v<T>) {
+				VIVIUM_ECS_CHECK(signature.enabled.test(component_id), severity::ERROR, "Attempted to get tag {} that entity didn't have", typeid(T).name());
+
+				return tag_instance<T>();
+			}
+			else {
+				return arrays[component_id].components.at<T>(entity.index);
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -8,7 +8,7 @@ using namespace Vivium::ECS;
 //  maybe to like entity_full_t, entity_t
 
 void page_array_test() {
-    paged_array_t<uint8_t, 100, 3, 999> my_array;
+    paged_array_t<uint32_t, 100, 3, 999> my_array;
 
     my_array.push(0, 0xa);
     my_array.push(1, 0xb);
@@ -6,8 +6,12 @@
 #include "archetype.h"
 #include "archetype.inl"
 #include "registry.inl"
+#include "rollback.h"
 
 #ifdef VIVIUM_ECS_MACROS_ENABLED
 #undef VIVIUM_ECS_MACROS_ENABLED
 #undef VIVIUM_ECS_ERROR
+#undef VIVIUM_ECS_PROFILE_COUNT
+#undef VIVIUM_ECS_PROFILE_ADD
+#undef VIVIUM_ECS_PROFILE_SCOPE
 #endif
\ No newline at end of file
@@ -12,26 +12,108 @@ namespace Vivium {
 			uint32_t m_index;
 
 			std::vector<component_array_t*> m_components;
+			// Pool of each sparse type in Ts, rows are skipped unless every pool has the entity
+			std::array<sparse_pool_t*, sizeof...(Ts)> m_pools{};
 
-			iterator(archetype_t* archetype, registry_id_t registry, uint32_t index = 0)
+			static constexpr bool m_has_sparse = (is_sparse_v<Ts> || ...);
+
+#ifdef VIVIUM_ECS_PROFILING
+			// The iterator returned by begin times the query from its construction until it
+			// goes out of scope, so empty queries and loops left early are recorded too
+			uint64_t m_query_start = 0;
+			bool m_timed = false;
+#endif
+
+			iterator(archetype_t* archetype, registry_id_t registry, uint32_t index = 0, sparse_pools_t* pools = nullptr, [[maybe_unused]] bool query = false)
 				: m_archetype(archetype), m_registry(registry), m_index(index)
 			{
-				if (m_archetype == nullptr)
-					VIVIUM_ECS_ERROR(severity::FATAL, "Can't iterate a null archetype");
+				VIVIUM_ECS_CHECK(m_archetype != nullptr, severity::FATAL, "Can't iterate a null archetype");
+				VIVIUM_ECS_CHECK(!m_has_sparse || pools != nullptr, severity::FATAL, "Iterating sparse components requires pools");
+
 				if (index != m_archetype->size)
 				{
+					uint32_t position = 0;
+
 					([&]() {
 						component_id_t component_id = component_registry<Ts>::get_id(m_registry);
 
-						m_components.push_back(
-							&(m_archetype->arrays[component_id].components)
-						);
+						// Tags and sparse components keep a null slot, so indices still line up with Ts
+						if constexpr (is_sparse_v<Ts>) {
+							m_pools[position] = (*pools)[component_id].get();
+							m_components.push_back(nullptr);
+						}
+						else {
+							m_components.push_back(
+								is_tag_v<Ts> ? nullptr : &(m_archetype->arrays[component_id].components)
+							);
+						}
+
+						++position;
 						}(), ...);
+
+					m_skip_unmatched();
 				}
+
+#ifdef VIVIUM_ECS_PROFILING
+				if (query) {
+					m_query_start = profiling::now();
+					m_timed = true;
+				}
+#endif
 			}
 
 			friend archetype_t;
 
+			// Tags only filter which archetypes are iterated, so yield the shared instance
+			template <typename T>
+			T& m_get(uint32_t index) const {
+				if constexpr (is_sparse_v<T>)
+					return m_pools[index]->template at<T>(m_archetype->entities[m_index]);
+				else if constexpr (is_tag_v<T>)
+					return tag_instance<T>();
+				else
+					return m_components[index]->at<T>(m_index);
+			}
+
+			template <size_t... indices>
+			std::tuple<Ts&...> m_get_all(std::index_sequence<indices...>) const {
+				return { m_get<Ts>(static_cast<uint32_t>(indices))... };
+			}
+
+			// Advance to the next enabled row whose entity has every sparse component
+			void m_skip_unmatched() {
+				while (m_index < m_archetype->size) {
+					// Only scan bits when something is disabled, so dense archetypes pay one compare
+					if (m_archetype->disabled_count != 0) {
+						m_index = m_archetype->next_enabled_row(m_index);
+
+						if (m_index == m_archetype->size) return;
+					}
+
+					if constexpr (m_has_sparse) {
+						entity_value_t entity = m_archetype->entities[m_index];
+
+						bool matched = true;
+
+						for (sparse_pool_t* pool : m_pools) {
+							if (pool != nullptr && !pool->contains(entity)) {
+								matched = false;
+
+								break;
+							}
+						}
+
+						if (!matched) {
+							++m_index;
+
+							continue;
+						}
+					}
+
+					return;
+				}
+			}
+
 		public:
 			using iterator_category = std::forward_iterator_tag;
 			using difference_type = std::ptrdiff_t;
@@ -39,42 +121,62 @@ namespace Vivium {
 			using pointer = value_type*;
 			using reference = value_type&;
 
-			reference operator*() const {
-				uint32_t index = 0;
+#ifdef VIVIUM_ECS_PROFILING
+			// Copies don't time the query, only the iterator begin returned does
+			iterator(const iterator& other)
+				: m_archetype(other.m_archetype), m_registry(other.m_registry), m_index(other.m_index),
+				m_components(other.m_components), m_pools(other.m_pools) {}
+
+			iterator& operator=(const iterator& other) {
+				m_archetype = other.m_archetype;
+				m_registry = other.m_registry;
+				m_index = other.m_index;
+				m_components = other.m_components;
+				m_pools = other.m_pools;
 
-				return std::make_tuple<Ts&...>(
-					m_components[index++]->at<Ts>(m_index)...
-				);
+				return *this;
 			}
 
-			template <typename T>
-			T& get() {
-				uint32_t index = 0;
+			~iterator() {
+				if (m_timed)
+					profiling::record(profiling::QUERIES, VIVIUM_ECS_FUNCTION, m_query_start, profiling::now());
+			}
+#endif
 
-				T* component = nullptr;
+			// Returns tuple of references by value
+			value_type operator*() const {
+				return m_get_all(std::index_sequence_for<Ts...>{});
+			}
 
-				([&]() {
-					if constexpr (std::is_same_v<T, Ts>) {
-						component = &m_components[index]->at<T>(m_index);
+			template <typename T>
+			T& get() {
+				static_assert((std::is_same_v<T, Ts> || ...), "Type was not in the iterated types");
 
-						return;
-					}
+				// Position of first T in Ts, counting until the fold short circuits
+				constexpr uint32_t index = []() {
+					uint32_t position = 0;
 
-					++index;
-				}(), ...);
+					((!std::is_same_v<T, Ts> && (++position, true)) && ...);
 
-				if (component == nullptr) {
-					VIVIUM_ECS_ERROR(severity::FATAL, "Type {} was not in archetype", typeid(T).name());
-				}
+					return position;
+				}();
 
-				return *component;
+				return m_get<T>(index);
 			}
 
-			// TODO: something about this
+			// Dereferencing yields a temporary tuple, so there's nothing for -> to point at,
+			// use get<T>() to reach a single component
 			pointer operator->() = delete;
 
-			iterator& operator++() { ++m_index; return *this; }
-			iterator& operator++(int) { iterator tmp = *this; ++(*this); return tmp; }
+			iterator& operator++() {
+				++m_index;
+
+				m_skip_unmatched();
+
+				return *this;
+			}
+
+			iterator operator++(int) { iterator tmp = *this; ++(*this); return tmp; }
 
 			bool operator==(const iterator& other) const {
 				return m_archetype == other.m_archetype &&
@@ -1,5 +1,11 @@
 #include "component.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
 namespace Vivium {
 	namespace ECS {
 		void component_array_t::m_fit_to(uint32_t index) {
@@ -21,17 +27,33 @@ namespace Vivium {
 		void component_array_t::m_destroy_data()
 		{
 			if (m_data != nullptr) {
-				m_manager.destroy_range(m_data, m_size);
-				delete[] m_data;
+				if (!m_manager.trivially_destructible)
+					m_manager.destroy_range(m_data, m_size);
+
+				if (m_owns_data)
+					m_free(m_data);
+
 				m_data = nullptr;
+				m_owns_data = true;
 				
 				m_size = 0;
 				m_capacity = 0;
 			}
 		}
 
+		uint8_t* component_array_t::m_allocate(uint32_t capacity) const {
+			return static_cast<uint8_t*>(::operator new(
+				static_cast<size_t>(capacity) * m_manager.size,
+				std::align_val_t(std::max<size_t>(m_manager.alignment, alignof(std::max_align_t)))
+			));
+		}
+
+		void component_array_t::m_free(uint8_t* data) const {
+			::operator delete(data, std::align_val_t(std::max<size_t>(m_manager.alignment, alignof(std::max_align_t))));
+		}
+
 		component_array_t::component_array_t()
-			: m_size(0), m_capacity(0), m_data(nullptr) {}
+			: m_size(0), m_capacity(0), m_data(nullptr), m_owns_data(true) {}
 
 		component_array_t::~component_array_t()
 		{
@@ -48,13 +70,17 @@ namespace Vivium {
 			: m_size(std::move(other.m_size)),
 			m_capacity(std::move(other.m_capacity)),
 			m_data(std::exchange(other.m_data, nullptr)),
+			m_owns_data(std::exchange(other.m_owns_data, true)),
 			m_manager(std::move(other.m_manager))
 		{}
 
 		component_array_t& component_array_t::operator=(component_array_t&& other) noexcept {
+			m_destroy_data();
+
 			m_size = std::move(other.m_size);
 			m_capacity = std::move(other.m_capacity);
 			m_data = std::exchange(other.m_data, nullptr);
+			m_owns_data = std::exchange(other.m_owns_data, true);
 			m_manager = std::move(other.m_manager);
 
 			return *this;
@@ -72,40 +98,58 @@ namespace Vivium {
 		void component_array_t::clear() {
 			if (m_data == nullptr) return;
 
-			m_manager.destroy_range(
-				m_data,
-				m_size
-			);
+			if (!m_manager.trivially_destructible)
+				m_manager.destroy_range(m_data, m_size);
 
 			m_size = 0;
 		}
 
 		void component_array_t::reserve(uint32_t new_capacity) {
-			// Ignore if new capacity was less than our current
-			if (new_capacity < m_capacity)
+			// Ignore if we already have enough, unless memory is external and needs copying
+			if (new_capacity < m_capacity || (new_capacity == m_capacity && m_owns_data))
 				return;
 			else {
+				VIVIUM_ECS_PROFILE_SCOPE(COLUMN_REALLOCATIONS, "reserve");
+
 				// Create bigger array
-				uint8_t* new_data = new uint8_t[
-					new_capacity * m_manager.size()
-				];
+				uint8_t* new_data = m_allocate(new_capacity);
 
 				if (m_data != nullptr) {
 					// Move all of old data into new array
-					m_manager.move_range(m_data, new_data, m_size);
+					m_move_elements(m_data, new_data, m_size);
 
 					// Delete old array
-					delete[] m_data;
+					if (m_owns_data)
+						m_free(m_data);
 				}
 
 				// Set m_data to the new array we created
 				m_data = new_data;
+				m_owns_data = true;
 
 				// Update capacity
 				m_capacity = new_capacity;
 			}
 		}
 
+		void component_array_t::shrink_to_fit() {
+			if (!m_owns_data || m_capacity == m_size) return;
+
+			uint8_t* new_data = m_size > 0 ? m_allocate(m_size) : nullptr;
+
+			if (new_data != nullptr)
+				m_move_elements(m_data, new_data, m_size);
+
+			m_free(m_data);
+
+			m_data = new_data;
+			m_capacity = m_size;
+		}
+
+		size_t component_array_t::memory_usage() const {
+			return m_owns_data ? static_cast<size_t>(m_capacity) * m_manager.size : 0;
+		}
+
 		uint32_t component_array_t::size() const { return m_size; }
 
 		bool component_array_t::is_empty() const { return m_size == 0; }
@@ -121,19 +165,28 @@ namespace Vivium {
 		}
 
 		void component_array_t::transfer_index_to_end_of(uint32_t index, component_array_t& other) {
+			// Counted once per column, too frequent to time individually
+			VIVIUM_ECS_PROFILE_COUNT(ROW_MOVES);
+
 			// Force destination to have enough space
 			other.m_fit_to(other.size());
 
 			uint8_t* src = m_manager.at(m_data, index);
 			uint8_t* dest = other.m_manager.at(other.m_data, other.size());
 
-			// Perform move
-			m_manager.move(src, dest);
-			// Fill in the gap we made in ourselves
-			m_manager.move(
-				m_manager.at(m_data, m_size - 1),
-				src
-			);
+			// Perform move, and fill in the gap we made in ourselves unless we moved the last element
+			if (m_manager.trivially_relocatable) {
+				std::memcpy(dest, src, m_manager.size);
+
+				if (index != m_size - 1)
+					std::memcpy(src, m_manager.at(m_data, m_size - 1), m_manager.size);
+			}
+			else {
+				m_manager.move(src, dest);
+
+				if (index != m_size - 1)
+					m_manager.move(m_manager.at(m_data, m_size - 1), src);
+			}
 
 			// Increment destinations size
 			other.m_size++;
@@ -141,23 +194,183 @@ namespace Vivium {
 			m_size--;
 		}
 
-		void component_array_t::pop_back() {
-			if (is_empty())
-				VIVIUM_ECS_ERROR(severity::ERROR, "Tried to pop empty array");
-			else {
-				m_manager.destroy(m_manager.at(m_data, --m_size));
+		void component_array_t::append_all_to(component_array_t& other) {
+			if (m_size == 0) return;
+
+			other.m_fit_to(other.m_size + m_size - 1);
+
+			m_move_elements(m_data, other.m_manager.at(other.m_data, other.m_size), m_size);
+
+			other.m_size += m_size;
+			m_size = 0;
+		}
+
+		void component_array_t::transfer_rows_to_end_of(const uint32_t* rows, uint32_t count, component_array_t& other) {
+			if (count == 0) return;
+
+			VIVIUM_ECS_PROFILE_ADD(ROW_MOVES, count);
+
+			other.m_fit_to(other.m_size + count - 1);
+
+			uint8_t* dest = other.m_manager.at(other.m_data, other.m_size);
+
+			// Move runs of consecutive rows together
+			for (uint32_t i = 0; i < count;) {
+				uint32_t run = 1;
+
+				while (i + run < count && rows[i + run] == rows[i] + run) ++run;
+
+				m_move_elements(m_manager.at(m_data, rows[i]), dest, run);
+
+				dest = other.m_manager.at(dest, run);
+				i += run;
+			}
+
+			other.m_size += count;
+
+			// Fill gaps left below the new end with the rows past it that weren't moved
+			uint32_t new_size = m_size - count;
+			uint32_t tail = new_size;
+			uint32_t next_moved = static_cast<uint32_t>(std::lower_bound(rows, rows + count, new_size) - rows);
+
+			for (uint32_t i = 0; i < count && rows[i] < new_size; i++) {
+				while (next_moved < count && rows[next_moved] == tail) {
+					++tail;
+					++next_moved;
+				}
+
+				m_move_elements(m_manager.at(m_data, tail++), m_manager.at(m_data, rows[i]), 1);
+			}
+
+			m_size = new_size;
+		}
+
+		void component_array_t::clone_from(const component_array_t& other) {
+			clear();
+			reserve(other.m_size);
+
+			if (other.m_size > 0)
+				m_manager.clone_range(other.m_data, m_data, other.m_size);
+
+			m_size = other.m_size;
+		}
+
+		void component_array_t::append_clones(const component_array_t& other, uint32_t index, uint32_t count) {
+			if (count == 0) return;
+
+			m_fit_to(m_size + count - 1);
+
+			uint8_t* first = m_manager.at(m_data, m_size);
+
+			m_manager.clone(other.m_manager.at(other.m_data, index), first);
+
+			// Double the copies each pass, so trivial types take log(count) memcpys
+			uint32_t cloned = 1;
+
+			while (cloned < count) {
+				uint32_t batch = std::min(cloned, count - cloned);
+
+				m_manager.clone_range(first, m_manager.at(first, cloned), batch);
+
+				cloned += batch;
 			}
+
+			m_size += count;
+		}
+
+		bool component_array_t::serialize(std::ostream& stream) const {
+			if (m_data == nullptr) return static_cast<bool>(stream);
+
+			return m_manager.serialize_range(m_data, m_size, stream);
+		}
+
+		bool component_array_t::deserialize(std::istream& stream, uint32_t count) {
+			clear();
+			reserve(count);
+
+			if (!m_manager.deserialize_range(stream, m_data, count))
+				return false;
+
+			m_size = count;
+
+			return true;
+		}
+
+		void component_array_t::use_external_data(uint8_t* data, uint32_t count) {
+			m_destroy_data();
+
+			m_data = data;
+			m_owns_data = false;
+
+			m_size = count;
+			m_capacity = count;
+		}
+
+		uint8_t* component_array_t::data() { return m_data; }
+
+		const uint8_t* component_array_t::data() const { return m_data; }
+
+		void component_array_t::resize_uninitialised(uint32_t count) {
+			if (count > m_capacity)
+				reserve(count);
+
+			m_size = count;
+		}
+
+		void component_array_t::reorder(const uint32_t* order) {
+			if (m_size == 0) return;
+
+			// Moving into a fresh buffer means each element is moved exactly once
+			uint8_t* new_data = m_allocate(m_capacity);
+
+			// Rows that stay consecutive are moved as one run
+			for (uint32_t i = 0; i < m_size;) {
+				uint32_t run = 1;
+
+				while (i + run < m_size && order[i + run] == order[i] + run) ++run;
+
+				m_move_elements(m_manager.at(m_data, order[i]), m_manager.at(new_data, i), run);
+
+				i += run;
+			}
+
+			if (m_owns_data)
+				m_free(m_data);
+
+			m_data = new_data;
+			m_owns_data = true;
+		}
+
+		void component_array_t::pop_back() {
+			VIVIUM_ECS_CHECK(!is_empty(), severity::ERROR, "Tried to pop empty array");
+
+			--m_size;
+
+			if (!m_manager.trivially_destructible)
+				m_manager.destroy(m_manager.at(m_data, m_size));
 		}
 
 		void component_array_t::erase(uint32_t index) {
-			if (!within_bounds(index))
-				VIVIUM_ECS_ERROR(severity::ERROR, "Tried to erase index that wasn't within bounds {} >= {}", index, m_size);
+			VIVIUM_ECS_CHECK(within_bounds(index), severity::ERROR,
+				"Tried to erase index that wasn't within bounds {} >= {}", index, m_size);
+
+			if (index == m_size - 1) {
+				pop_back();
+			}
 			else {
-				// Swap remove component data
-				m_manager.swap_remove(
-					m_manager.at(m_data, index),		// this element gets deleted
-					m_manager.at(m_data, m_size - 1)	// this element fills the slot
-				);
+				uint8_t* removed = m_manager.at(m_data, index);
+				uint8_t* last = m_manager.at(m_data, m_size - 1);
+
+				// Swap remove component data, last element fills the slot
+				if (m_manager.trivially_relocatable) {
+					if (!m_manager.trivially_destructible)
+						m_manager.destroy(removed);
+
+					std::memcpy(removed, last, m_manager.size);
+				}
+				else {
+					m_manager.swap_remove(removed, last);
+				}
 
 				--m_size;
 			}
@@ -172,8 +385,13 @@ namespace Vivium {
 			destroy_range(other.destroy_range),
 			swap(other.swap),
 			swap_remove(other.swap_remove),
-			at(other.at),
-			size(other.size)
+			serialize_range(other.serialize_range),
+			deserialize_range(other.deserialize_range),
+			size(other.size),
+			alignment(other.alignment),
+			trivially_copyable(other.trivially_copyable),
+			trivially_relocatable(other.trivially_relocatable),
+			trivially_destructible(other.trivially_destructible)
 		{}
 
 		component_manager_t& component_manager_t::operator=(const component_manager_t& other)
@@ -186,8 +404,13 @@ namespace Vivium {
 			destroy_range = other.destroy_range;
 			swap = other.swap;
 			swap_remove = other.swap_remove;
-			at = other.at;
+			serialize_range = other.serialize_range;
+			deserialize_range = other.deserialize_range;
 			size = other.size;
+			alignment = other.alignment;
+			trivially_copyable = other.trivially_copyable;
+			trivially_relocatable = other.trivially_relocatable;
+			trivially_destructible = other.trivially_destructible;
 
 			return *this;
 		}
@@ -201,8 +424,13 @@ namespace Vivium {
 			destroy_range(nullptr),
 			swap(nullptr),
 			swap_remove(nullptr),
-			at(nullptr),
-			size(nullptr) {}
+			serialize_range(nullptr),
+			deserialize_range(nullptr),
+			size(0),
+			alignment(0),
+			trivially_copyable(false),
+			trivially_relocatable(false),
+			trivially_destructible(false) {}
 		
 		component_manager_t::component_manager_t(component_manager_t&& other) noexcept
 			: move(std::move(other.move)),
@@ -213,22 +441,32 @@ namespace Vivium {
 			destroy_range(std::move(other.destroy_range)),
 			swap(std::move(other.swap)),
 			swap_remove(std::move(other.swap_remove)),
-			at(std::move(other.at)),
-			size(std::move(other.size))
+			serialize_range(std::move(other.serialize_range)),
+			deserialize_range(std::move(other.deserialize_range)),
+			size(std::move(other.size)),
+			alignment(std::move(other.alignment)),
+			trivially_copyable(std::move(other.trivially_copyable)),
+			trivially_relocatable(std::move(other.trivially_relocatable)),
+			trivially_destructible(std::move(other.trivially_destructible))
 		{}
 
 		component_manager_t& component_manager_t::operator=(component_manager_t&& other) noexcept
 		{
-			move			= std::move(other.move);
-			move_range		= std::move(other.move_range);
-			clone			= std::move(other.clone);
-			clone_range		= std::move(other.clone_range);
-			destroy			= std::move(other.destroy);
-			destroy_range	= std::move(other.destroy_range);
-			swap			= std::move(other.swap);
-			swap_remove		= std::move(other.swap_remove);
-			at				= std::move(other.at);
-			size			= std::move(other.size);
+			move = std::move(other.move);
+			move_range = std::move(other.move_range);
+			clone = std::move(other.clone);
+			clone_range = std::move(other.clone_range);
+			destroy = std::move(other.destroy);
+			destroy_range = std::move(other.destroy_range);
+			swap = std::move(other.swap);
+			swap_remove = std::move(other.swap_remove);
+			serialize_range = std::move(other.serialize_range);
+			deserialize_range = std::move(other.deserialize_range);
+			size = std::move(other.size);
+			alignment = std::move(other.alignment);
+			trivially_copyable = std::move(other.trivially_copyable);
+			trivially_relocatable = std::move(other.trivially_relocatable);
+			trivially_destructible = std::move(other.trivially_destructible);
 
 			return *this;
 		}
@@ -1,20 +1,82 @@
 #pragma once
 
 #include "error_handler.h"
+#include "serialization.h"
+#include "profiling.h"
+
+#include <array>
+#include <cstring>
+#include <new>
+#include <typeinfo>
+#include <utility>
 
 namespace Vivium {
 	namespace ECS {
+		// A type is trivially relocatable if moving it to new memory and ending the lifetime
+		// of the original is equivalent to copying its bytes, so columns can move it with
+		// memcpy. Detected for trivially copyable types, specialise to opt in other types
+		// that don't point into themselves, e.g. those holding a std::unique_ptr
+		template <typename T>
+		struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+		template <typename T>
+		constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+		// Components with no data are tags, only stored as a bit in archetype signatures
+		template <typename T>
+		constexpr bool is_tag_v = std::is_empty_v<T>;
+
+		enum class storage_policy {
+			ARCHETYPE,
+			SPARSE
+		};
+
+		// Where a component is stored. Specialise to SPARSE for components that are added and
+		// removed often, they are kept in a pool keyed by entity instead of in archetypes, so
+		// toggling them doesn't move the entity's other components
+		template <typename T>
+		struct component_storage_policy : std::integral_constant<storage_policy, storage_policy::ARCHETYPE> {};
+
+		template <typename T>
+		constexpr bool is_sparse_v = component_storage_policy<T>::value == storage_policy::SPARSE;
+
+		// Positions in Ts of the components stored in archetypes, so a pack mixing storage
+		// policies can be split
+		template <typename... Ts>
+		constexpr auto archetype_positions_v = []() {
+			constexpr bool sparse[] = { is_sparse_v<Ts>..., false };
+
+			std::array<size_t, (0 + ... + (is_sparse_v<Ts> ? 0 : 1))> positions{};
+			size_t count = 0;
+
+			for (size_t i = 0; i < sizeof...(Ts); i++) {
+				if (!sparse[i])
+					positions[count++] = i;
+			}
+
+			return positions;
+		}();
+
+		// Tags have no storage, so every access shares one instance
+		template <typename T>
+		T& tag_instance() {
+			static T instance{};
+
+			return instance;
+		}
+
 		// All functions assume destination is unallocated memory
 		// Move will destroy the source, maintaining total number of instances
 		// Clone will simply copy, creating new instance
 		template <typename T>
 		struct component_manager_definitions {
 			static void move(uint8_t* src, uint8_t* dest) {
-				if constexpr (std::is_trivial_v<T>) {
+				if constexpr (is_trivially_relocatable_v<T>) {
 					std::memcpy(dest, src, sizeof(T));
 				}
 				else if constexpr (std::is_move_constructible_v<T>) {
 					new (dest) T(std::move(*reinterpret_cast<T*>(src)));
+					destroy(src);
 				}
 				else if constexpr (std::is_copy_constructible_v<T>) {
 					new (dest) T(*reinterpret_cast<const T*>(src));
@@ -26,18 +88,18 @@ namespace Vivium {
 			}
 
 			static void move_range(uint8_t* src, uint8_t* dest, uint32_t count) {
-				if constexpr (std::is_trivial_v<T>) {
-					memcpy(dest, src, sizeof(T) * count);
+				if constexpr (is_trivially_relocatable_v<T>) {
+					std::memcpy(dest, src, sizeof(T) * count);
 				}
 				else {
 					for (uint32_t i = 0; i < count; i++) {
-						move(&dest[i * sizeof(T)], &src[i * sizeof(T)]);
+						move(&src[i * sizeof(T)], &dest[i * sizeof(T)]);
 					}
 				}
 			}
 
 			static void clone(uint8_t* src, uint8_t* dest) {
-				if constexpr (std::is_trivial_v<T>) {
+				if constexpr (std::is_trivially_copyable_v<T>) {
 					std::memcpy(dest, src, sizeof(T));
 				}
 				else if constexpr (std::is_copy_constructible_v<T>) {
@@ -49,24 +111,24 @@ namespace Vivium {
 			}
 
 			static void clone_range(uint8_t* src, uint8_t* dest, uint32_t count) {
-				if constexpr (std::is_trivial_v<T>) {
+				if constexpr (std::is_trivially_copyable_v<T>) {
 					std::memcpy(dest, src, sizeof(T) * count);
 				}
 				else {
 					for (uint32_t i = 0; i < count; i++) {
-						clone(&dest[i * sizeof(T)], &src[i * sizeof(T)]);
+						clone(&src[i * sizeof(T)], &dest[i * sizeof(T)]);
 					}
 				}
 			}
 
 			static void destroy(uint8_t* location) {
-				if constexpr (!std::is_trivial_v<T>) {
+				if constexpr (!std::is_trivially_destructible_v<T>) {
 					reinterpret_cast<T*>(location)->~T();
 				}
 			}
 
 			static void destroy_range(uint8_t* location, uint32_t count) {
-				if constexpr (!std::is_trivial_v<T>) {
+				if constexpr (!std::is_trivially_destructible_v<T>) {
 					for (uint32_t i = 0; i < count; i++) {
 						destroy(&location[i * sizeof(T)]);
 					}
@@ -75,13 +137,11 @@ namespace Vivium {
 
 			static void swap(uint8_t* a, uint8_t* b) {
 				// Location to temporarily store
-				uint8_t* tmp = new uint8_t[sizeof(T)];
+				alignas(T) uint8_t tmp[sizeof(T)];
 
 				move(a, tmp);
 				move(b, a);
 				move(tmp, b);
-
-				delete[] tmp;
 			}
 
 			static void swap_remove(uint8_t* remove, uint8_t* replacement) {
@@ -91,12 +151,47 @@ namespace Vivium {
 				move(replacement, remove);
 			}
 
-			static uint8_t* at(uint8_t* src, uint32_t index) {
-				return &src[index * sizeof(T)];
+			static bool serialize_range(const uint8_t* src, uint32_t count, std::ostream& stream) {
+				if constexpr (std::is_trivially_copyable_v<T>) {
+					stream.write(reinterpret_cast<const char*>(src), sizeof(T) * count);
+				}
+				else if constexpr (has_component_serializer<T>) {
+					for (uint32_t i = 0; i < count; i++) {
+						component_serializer<T>::save(stream, *reinterpret_cast<const T*>(&src[i * sizeof(T)]));
+					}
+				}
+				else {
+					VIVIUM_ECS_ERROR(severity::ERROR, "No method to serialize type {}", typeid(T).name());
+
+					return false;
+				}
+
+				return static_cast<bool>(stream);
 			}
 
-			static uint32_t size() {
-				return sizeof(T);
+			// Assumes destination is unallocated memory, on failure leaves it unallocated
+			static bool deserialize_range(std::istream& stream, uint8_t* dest, uint32_t count) {
+				if constexpr (std::is_trivially_copyable_v<T>) {
+					return static_cast<bool>(stream.read(reinterpret_cast<char*>(dest), sizeof(T) * count));
+				}
+				else if constexpr (has_component_serializer<T>) {
+					for (uint32_t i = 0; i < count; i++) {
+						new (&dest[i * sizeof(T)]) T(component_serializer<T>::load(stream));
+
+						if (!stream) {
+							destroy_range(dest, i + 1);
+
+							return false;
+						}
+					}
+
+					return true;
+				}
+				else {
+					VIVIUM_ECS_ERROR(severity::ERROR, "No method to deserialize type {}", typeid(T).name());
+
+					return false;
+				}
 			}
 		};
 
@@ -113,8 +208,8 @@ namespace Vivium {
 			typedef void (*swap_t)(uint8_t* a, uint8_t* b);
 			typedef void (*swap_remove_t)(uint8_t* remove, uint8_t* replacement);
 
-			typedef uint8_t* (*at_t)(uint8_t* src, uint32_t index);
-			typedef uint32_t(*get_size_t)();
+			typedef bool (*serialize_range_t)(const uint8_t* src, uint32_t count, std::ostream& stream);
+			typedef bool (*deserialize_range_t)(std::istream& stream, uint8_t* dest, uint32_t count);
 
 			move_t move;
 			move_range_t move_range;
@@ -128,8 +223,15 @@ namespace Vivium {
 			swap_t swap;
 			swap_remove_t swap_remove;
 
-			at_t at;
-			get_size_t size;
+			serialize_range_t serialize_range;
+			deserialize_range_t deserialize_range;
+
+			// Kept as plain data so addressing and bytewise moves need no indirect call
+			uint32_t size;
+			uint32_t alignment;
+			bool trivially_copyable;
+			bool trivially_relocatable;
+			bool trivially_destructible;
 
 			component_manager_t();
 
@@ -139,6 +241,10 @@ namespace Vivium {
 			component_manager_t(component_manager_t&& other) noexcept;
 			component_manager_t& operator=(component_manager_t&& other) noexcept;
 
+			uint8_t* at(uint8_t* src, uint32_t index) const {
+				return src + static_cast<size_t>(index) * size;
+			}
+
 			template<typename T, typename... Args>
 			void create(uint8_t* src, uint32_t index, Args&&... args) const {
 				new (at(src, index)) T(std::forward<Args>(args)...);
@@ -162,8 +268,14 @@ namespace Vivium {
 
 				swap = component_manager_definitions<T>::swap;
 				swap_remove = component_manager_definitions<T>::swap_remove;
-				at = component_manager_definitions<T>::at;
-				size = component_manager_definitions<T>::size;
+				serialize_range = component_manager_definitions<T>::serialize_range;
+				deserialize_range = component_manager_definitions<T>::deserialize_range;
+
+				size = sizeof(T);
+				alignment = alignof(T);
+				trivially_copyable = std::is_trivially_copyable_v<T>;
+				trivially_relocatable = is_trivially_relocatable_v<T>;
+				trivially_destructible = std::is_trivially_destructible_v<T>;
 			}
 		};
 
@@ -174,12 +286,26 @@ namespace Vivium {
 
 			// Component data
 			uint8_t* m_data;
+			// False if m_data points into memory we don't own (i.e. a mapped snapshot)
+			bool m_owns_data;
 
 			component_manager_t m_manager;
 
 			void m_fit_to(uint32_t index);
 			void m_destroy_data();
 
+			// Allocate and free storage aligned for the managed type
+			uint8_t* m_allocate(uint32_t capacity) const;
+			void m_free(uint8_t* data) const;
+
+			// Move count elements to uninitialised memory, bytewise if relocatable
+			void m_move_elements(uint8_t* src, uint8_t* dest, uint32_t count) const {
+				if (m_manager.trivially_relocatable)
+					std::memcpy(dest, src, static_cast<size_t>(count) * m_manager.size);
+				else
+					m_manager.move_range(src, dest, count);
+			}
+
 		public:
 			component_array_t();
 			~component_array_t();
@@ -209,14 +335,58 @@ namespace Vivium {
 			void clear();
 
 			void reserve(uint32_t new_capacity);
+			// Reallocate to hold exactly the current components, freeing the storage if
+			// there are none. Columns pointing into a mapping are left alone
+			void shrink_to_fit();
+
+			// Bytes allocated for components, zero for columns pointing into a mapping
+			size_t memory_usage() const;
 
 			uint32_t size() const;
+			uint32_t capacity() const { return m_capacity; }
 			bool is_empty() const;
 			bool within_bounds(uint32_t index) const;
 			component_manager_t get_manager() const;
 
 			void transfer_index_to_end_of(uint32_t index, component_array_t& other);
 
+			// Move every component to the end of other in one go, leaving this empty. Other
+			// must be managing the same type
+			void append_all_to(component_array_t& other);
+
+			// Move count rows, sorted ascending without duplicates, to the end of other in
+			// that order. Gaps are filled from the end, so rows are only ever moved once
+			void transfer_rows_to_end_of(const uint32_t* rows, uint32_t count, component_array_t& other);
+
+			// Rearrange elements so element order[i] ends up at i, order must be a
+			// permutation of every index
+			void reorder(const uint32_t* order);
+
+			// Replace all components with copies of the components in other,
+			// other must be managing the same type
+			void clone_from(const component_array_t& other);
+
+			// Append count copies of the component at index in other, other must
+			// be managing the same type
+			void append_clones(const component_array_t& other, uint32_t index, uint32_t count);
+
+			// Write all components to the stream, in order
+			bool serialize(std::ostream& stream) const;
+			// Replace all components with count components read from the stream
+			bool deserialize(std::istream& stream, uint32_t count);
+
+			// Replace all components with count already initialised components stored
+			// in external memory, which must outlive this array. Memory is not freed,
+			// and is copied into memory we own on the next reallocation
+			void use_external_data(uint8_t* data, uint32_t count);
+
+			uint8_t* data();
+			const uint8_t* data() const;
+
+			// Set size without constructing or destroying any components,
+			// only valid for trivially copyable components
+			void resize_uninitialised(uint32_t count);
+
 			// Assuming element at index is just uninitialised memory
 			template <typename T>
 			void construct_at(const T& element, uint32_t index) {
@@ -225,10 +395,17 @@ namespace Vivium {
 
 			template <typename T>
 			void replace_at(const T& element, uint32_t index) {
+				emplace_at<T>(index, element);
+			}
+
+			// Destroy element at index, and construct a new one in place from args
+			template <typename T, typename... Args>
+			void emplace_at(uint32_t index, Args&&... args) {
 				// Destroy element
-				m_manager.destroy(m_manager.at(m_data, index));
+				if constexpr (!std::is_trivially_destructible_v<T>)
+					m_manager.destroy(m_manager.at(m_data, index));
 				// Construct at location
-				construct_at<T>(element, index);
+				m_manager.create<T>(m_data, index, std::forward<Args>(args)...);
 			}
 
 			template <typename T>
@@ -244,7 +421,7 @@ namespace Vivium {
 				// Make array fit another element at least
 				m_fit_to(m_size);
 				// Construct element at end of array
-				m_manager.create<T>(m_data, m_size++, std::forward<Args&&>(args)...);
+				m_manager.create<T>(m_data, m_size++, std::forward<Args>(args)...);
 			}
 
 			void pop_back();
@@ -252,20 +429,16 @@ namespace Vivium {
 
 			template <typename T>
 			T& at(uint32_t index) {
-				if (!within_bounds(index))
-					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to access OOB element");
-				else {
-					return m_manager.value_at<T>(m_data, index);
-				}
+				VIVIUM_ECS_CHECK(within_bounds(index), severity::ERROR, "Attempted to access OOB element");
+
+				return m_manager.value_at<T>(m_data, index);
 			}
 
 			template <typename T>
 			const T& at(uint32_t index) const {
-				if (!within_bounds(index))
-					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to access OOB element");
-				else {
-					return m_manager.value_at<T>(m_data, index);
-				}
+				VIVIUM_ECS_CHECK(within_bounds(index), severity::ERROR, "Attempted to access OOB element");
+
+				return m_manager.value_at<T>(m_data, index);
 			}
 		};
 	}
@@ -4,6 +4,7 @@
 #include "constants.h"
 #include "error_handler.h"
 
+#include <typeinfo>
 #include <unordered_map>
 
 namespace Vivium {
@@ -35,6 +36,30 @@ namespace Vivium {
 				// Didn't find a component for that specific registry
 				return COMPONENT_NULL_ID;
 			}
+
+			// Remove component id for a given registry, so the registry id can be reused
+			static void unregister_component(registry_id_t registry) {
+				m_registry_to_component.erase(registry);
+			}
+		};
+
+		// Type-erased access to the component_registry of a type
+		struct component_registration_t {
+			typedef void (*register_component_t)(registry_id_t registry, component_id_t component);
+			typedef void (*unregister_component_t)(registry_id_t registry);
+			typedef component_id_t (*get_id_t)(registry_id_t registry);
+
+			register_component_t register_component = nullptr;
+			unregister_component_t unregister_component = nullptr;
+			// Id of the same type in another registry, to match components across registries
+			get_id_t get_id = nullptr;
+
+			template <typename T>
+			void setup() {
+				register_component = component_registry<T>::register_component;
+				unregister_component = component_registry<T>::unregister_component;
+				get_id = component_registry<T>::get_id;
+			}
 		};
 
 		// Instantiate
@@ -3,33 +3,81 @@
 #include <cstdint>
 #define VIVIUM_ECS_MACROS_ENABLED
 
+// Limits chosen per build through the CMake cache options of the same name, which
+// apply them to the library and everything linking it. Every translation unit must
+// agree on them, see limits_tag_t. Registries built with different limits can't
+// load each other's snapshots
+
+// Component types per registry, including tags. Sets the width of signatures and the
+// per component block of each archetype, so smaller limits make both cheaper
+#ifndef VIVIUM_ECS_MAX_COMPONENTS
+#define VIVIUM_ECS_MAX_COMPONENTS 256
+#endif
+
+// Bits of an entity value used for its id, the rest hold its version
+#ifndef VIVIUM_ECS_ENTITY_ID_BITS
+#define VIVIUM_ECS_ENTITY_ID_BITS 20
+#endif
+
+// Entities per page of the lookups from entity to row
+#ifndef VIVIUM_ECS_ENTITY_PAGE_SIZE
+#define VIVIUM_ECS_ENTITY_PAGE_SIZE 1024
+#endif
+
 namespace Vivium {
 	namespace ECS {
 		using component_id_t = uint16_t;
 		using entity_value_t = uint32_t;
 		using registry_id_t	 = uint16_t;
+		using resource_id_t	 = uint16_t;
+		using relation_id_t	 = uint16_t;
+
+		constexpr uint32_t MAX_COMPONENTS = VIVIUM_ECS_MAX_COMPONENTS;
+		constexpr component_id_t COMPONENT_NULL_ID = MAX_COMPONENTS - 1;
 
-		constexpr component_id_t COMPONENT_NULL_ID = 0xff;
-		constexpr uint32_t MAX_COMPONENTS = COMPONENT_NULL_ID + 1;
+		static_assert(MAX_COMPONENTS % 64 == 0, "Signatures are stored as whole 64-bit words");
+		static_assert(MAX_COMPONENTS >= 64 && MAX_COMPONENTS <= 0x10000, "Component ids must fit component_id_t");
 
 		constexpr registry_id_t REGISTRY_NULL_ID = 0xffff;
 		constexpr uint32_t MAX_REGISTRIES = REGISTRY_NULL_ID + 1;
 
 		constexpr entity_value_t ENTITY_NULL  = 0xffffffff;
 
-		constexpr entity_value_t ENTITY_NULL_ID	= 0x000fffff;
+		constexpr uint32_t ENTITY_ID_BITS = VIVIUM_ECS_ENTITY_ID_BITS;
+
+		static_assert(ENTITY_ID_BITS >= 8 && ENTITY_ID_BITS < 32, "Entity values need id bits and at least one version bit");
+
+		constexpr entity_value_t ENTITY_NULL_ID	= (entity_value_t(1) << ENTITY_ID_BITS) - 1;
 		constexpr uint32_t MAX_ENTITIES		= ENTITY_NULL_ID;
 		constexpr uint32_t ENTITY_MASK_ID	= ENTITY_NULL_ID;
 		constexpr uint32_t MAX_ENTITY_ID	= ENTITY_NULL_ID;
 
-		constexpr entity_value_t ENTITY_NULL_VERSION = 0xfff00000;
+		constexpr entity_value_t ENTITY_NULL_VERSION = ~ENTITY_NULL_ID;
 		constexpr uint32_t ENTITY_MASK_VERSION	= ENTITY_NULL_VERSION;
 		constexpr uint32_t MAX_ENTITY_VERSION	= ENTITY_NULL_VERSION;
-		constexpr uint32_t ENTITY_SHIFT_VERSION = 5 * 4;
+		constexpr uint32_t ENTITY_SHIFT_VERSION = ENTITY_ID_BITS;
 
-		constexpr uint32_t ENTITY_SPARSE_PAGE_SIZE = 1024;
+		constexpr uint32_t ENTITY_SPARSE_PAGE_SIZE = VIVIUM_ECS_ENTITY_PAGE_SIZE;
 		constexpr uint32_t ID_GEN_SPARSE_PAGE_SIZE = 1024;
 
 		constexpr uint32_t INVALID_INDEX = 0xffffffff;
+
+		constexpr uint32_t SNAPSHOT_MAGIC	= 0x53434556; // "VECS"
+		constexpr uint32_t SNAPSHOT_VERSION = 8;
+		// Column data is aligned within the snapshot so it can be used in place when mapped
+		constexpr uint32_t SNAPSHOT_ALIGNMENT = 64;
+
+		// Granularity at which rollback checkpoints detect changed bytes
+		constexpr uint32_t ROLLBACK_CHUNK_SIZE = 256;
+
+		// Number of most recent errors kept, must be a power of two
+		constexpr uint32_t ERROR_LOG_CAPACITY = 1024;
+
+		template <uint32_t max_components, uint32_t entity_id_bits, uint32_t entity_page_size>
+		struct basic_limits_tag_t {};
+
+		// Part of the signature of the registry constructor, so code compiled with other
+		// limits than the library fails to link instead of silently disagreeing on layouts
+		using limits_tag_t = basic_limits_tag_t<MAX_COMPONENTS, ENTITY_ID_BITS, ENTITY_SPARSE_PAGE_SIZE>;
 	}
 }
\ No newline at end of file
@@ -3,7 +3,7 @@
 
 namespace Vivium {
 	namespace ECS {
-		entity_t::entity_t() : value(ENTITY_NULL), archetype(nullptr), index(INVALID_INDEX) {}
+		entity_t::entity_t() : archetype(nullptr), value(ENTITY_NULL), index(INVALID_INDEX) {}
 		
 		uint32_t entity_t::id(entity_value_t value) {
 			return value & ENTITY_MASK_ID;
@@ -14,11 +14,11 @@ namespace Vivium {
 		}
 		
 		uint32_t entity_t::set_id(uint32_t value, uint32_t id) {
-			return value & ENTITY_MASK_VERSION + id;
+			return (value & ENTITY_MASK_VERSION) | (id & ENTITY_MASK_ID);
 		}
 		
 		uint32_t entity_t::set_version(uint32_t value, uint32_t version) {
-			return value & ENTITY_MASK_ID + (version << ENTITY_SHIFT_VERSION);
+			return (value & ENTITY_MASK_ID) | ((version << ENTITY_SHIFT_VERSION) & ENTITY_MASK_VERSION);
 		}
 	}
 }
@@ -6,9 +6,10 @@ namespace Vivium {
 	namespace ECS {
 		struct archetype_t;
 
+		// Ordered to avoid padding, so entities can be compared bytewise
 		struct entity_t {
-			entity_value_t value;
 			archetype_t* archetype;
+			entity_value_t value;
 			uint32_t index; // Index within archetype
 
 			entity_t();
@@ -1,5 +1,9 @@
 #include "error_handler.h"
 
+#include <cstdlib>
+#include <iomanip>
+#include <vector>
+
 namespace Vivium {
 	namespace ECS {
 		void default_error_callback(error_detail detail) {}
@@ -14,28 +18,58 @@ namespace Vivium {
 			}
 		}
 
+		namespace {
+			void print_error(const error_detail& detail) {
+				// Time of day in UTC, not every standard library can format time points
+				std::chrono::hh_mm_ss time(
+					std::chrono::floor<std::chrono::seconds>(detail.timestamp.time_since_epoch()) % std::chrono::days(1)
+				);
+
+				std::cout << "[" << std::setfill('0')
+					<< std::setw(2) << time.hours().count() << ":"
+					<< std::setw(2) << time.minutes().count() << ":"
+					<< std::setw(2) << time.seconds().count() << "] "
+					<< ECS::format("{}: {}:{} {}",
+						severity_to_string(detail.sev),
+						detail.file,
+						detail.line,
+						detail.message
+					) << std::endl;
+			}
+		}
+
 		void print_errors(severity minimum) {
-			for (const error_detail& detail : error_list) {
-				if (detail.sev < minimum) continue;
-
-				std::cout << std::format(
-					"[{:%H:%M:%OS}] {}: {}:{} {}",
-					detail.timestamp,
-					severity_to_string(detail.sev),
-					detail.file,
-					detail.line,
-					detail.message
-				) << std::endl;
+			// Pushes from other threads can pop to make room, so reading slots in place
+			// would race with them. Drain into a local list instead, then put it back
+			std::vector<error_detail> errors;
+			error_detail detail;
+
+			while (errors.size() < ERROR_LOG_CAPACITY && error_list.try_pop(detail)) {
+				errors.push_back(std::move(detail));
+			}
+
+			for (const error_detail& error : errors) {
+				if (error.sev >= minimum)
+					print_error(error);
+			}
+
+			for (const error_detail& error : errors) {
+				error_list.push_overwrite(error);
 			}
 		}
 
 		void consume_errors() {
-			print_errors();
-			error_list.clear();
+			error_detail detail;
+
+			// Pop one at a time, so errors pushed meanwhile by other threads aren't lost
+			while (error_list.try_pop(detail)) {
+				if (detail.sev >= severity::WARN)
+					print_error(detail);
+			}
 		}
 
 		void push_error(const error_detail& detail) {
-			error_list.push_back(detail);
+			error_list.push_overwrite(detail);
 
 			error_callback(detail);
 
@@ -47,6 +81,12 @@ namespace Vivium {
 			}
 		}
 
+		void check_failed(const char* file, uint32_t line, const char* condition) {
+			std::cerr << "-- CHECK FAILED -- " << file << ":" << line << " " << condition << std::endl;
+
+			std::abort();
+		}
+
 		error_detail::error_detail(const char* file, const char* function, uint32_t line, severity sev, std::string message) :
 			file(file), function(function), line(line),
 			sev(sev), message(message),
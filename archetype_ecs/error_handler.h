@@ -1,10 +1,20 @@
 #pragma once
 
+#include "constants.h"
+#include "ring_buffer.h"
+
 #include <cstdint>
 #include <iostream>
-#include <format>
+#include <sstream>
 #include <chrono>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <version>
+
+#if __has_include(<format>)
+#include <format>
+#endif
 
 namespace Vivium {
 	namespace ECS {
@@ -27,29 +37,106 @@ namespace Vivium {
 		const char* severity_to_string(severity sev);
 
 		struct error_detail {
-			const char* file;
-			const char* function;
-			uint32_t line;
+			const char* file = nullptr;
+			const char* function = nullptr;
+			uint32_t line = 0;
 
-			severity sev;
+			severity sev = severity::DEBUG;
 			std::string message;
 
 			std::chrono::system_clock::time_point timestamp;
 
+			error_detail() = default;
 			error_detail(const char* file, const char* function, uint32_t line,
 				severity sev, std::string message);
 		};
 
-		inline std::vector<error_detail> error_list;
+		// Most recent errors, oldest are discarded once full, safe to push from any thread
+		inline ring_buffer_t<error_detail, ERROR_LOG_CAPACITY> error_list;
 
+		// Print errors at or above minimum, leaving them in the log
 		void print_errors(severity minimum = severity::WARN);
 
+		// Print and remove all errors
 		void consume_errors();
 
 		void push_error(const error_detail& detail);
+
+		// Report failed check at the debug checking level and abort
+		[[noreturn]] void check_failed(const char* file, uint32_t line, const char* condition);
+
+#ifndef __cpp_lib_format
+		namespace detail {
+			inline void format_to(std::ostringstream& output, std::string_view message) {
+				output << message;
+			}
+
+			template <typename T, typename... Args>
+			void format_to(std::ostringstream& output, std::string_view message, const T& argument, const Args&... arguments) {
+				size_t open = message.find('{');
+				size_t close = open == std::string_view::npos ? open : message.find('}', open);
+
+				if (close == std::string_view::npos) {
+					output << message;
+
+					return;
+				}
+
+				output << message.substr(0, open) << argument;
+
+				format_to(output, message.substr(close + 1), arguments...);
+			}
+		}
+
+		// Fallback for standard libraries without std::format, replaces each
+		// replacement field in order, ignoring any format specification
+		template <typename... Args>
+		std::string format(std::string_view message, const Args&... arguments) {
+			std::ostringstream output;
+
+			detail::format_to(output, message, arguments...);
+
+			return output.str();
+		}
+#else
+		using std::format;
+#endif
 	}
 }
 
-#define VIVIUM_ECS_ERROR(_severity, _message, ...) \
-	Vivium::ECS::push_error(Vivium::ECS::error_detail(__FILE__, __FUNCSIG__, __LINE__, \
-		_severity, std::format(_message, __VA_ARGS__)))
\ No newline at end of file
+#if defined(_MSC_VER)
+#define VIVIUM_ECS_FUNCTION __FUNCSIG__
+#else
+#define VIVIUM_ECS_FUNCTION __PRETTY_FUNCTION__
+#endif
+
+// Message and its arguments are passed together, so no trailing comma is left without arguments
+#define VIVIUM_ECS_ERROR(_severity, ...) \
+	Vivium::ECS::push_error(Vivium::ECS::error_detail(__FILE__, VIVIUM_ECS_FUNCTION, __LINE__, \
+		_severity, Vivium::ECS::format(__VA_ARGS__)))
+
+// Checking levels for VIVIUM_ECS_CHECK, used on hot paths such as lookups and bounds checks
+//	RELEASE		checks compiled out entirely
+//	DEBUG		failed checks abort, without formatting or logging
+//	DIAGNOSTIC	failed checks are logged with VIVIUM_ECS_ERROR
+#define VIVIUM_ECS_CHECK_RELEASE	0
+#define VIVIUM_ECS_CHECK_DEBUG		1
+#define VIVIUM_ECS_CHECK_DIAGNOSTIC 2
+
+#ifndef VIVIUM_ECS_CHECK_LEVEL
+#ifdef NDEBUG
+#define VIVIUM_ECS_CHECK_LEVEL VIVIUM_ECS_CHECK_RELEASE
+#else
+#define VIVIUM_ECS_CHECK_LEVEL VIVIUM_ECS_CHECK_DIAGNOSTIC
+#endif
+#endif
+
+#if VIVIUM_ECS_CHECK_LEVEL == VIVIUM_ECS_CHECK_RELEASE
+#define VIVIUM_ECS_CHECK(_condition, _severity, ...) ((void)0)
+#elif VIVIUM_ECS_CHECK_LEVEL == VIVIUM_ECS_CHECK_DEBUG
+#define VIVIUM_ECS_CHECK(_condition, _severity, ...) \
+	do { if (!(_condition)) [[unlikely]] Vivium::ECS::check_failed(__FILE__, __LINE__, #_condition); } while (0)
+#else
+#define VIVIUM_ECS_CHECK(_condition, _severity, ...) \
+	do { if (!(_condition)) [[unlikely]] VIVIUM_ECS_ERROR(_severity, __VA_ARGS__); } while (0)
+#endif
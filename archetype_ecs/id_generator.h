@@ -2,6 +2,7 @@
 
 #include "constants.h"
 #include "paged_array.h"
+#include "serialization.h"
 
 #include <vector>
 #include <utility>
@@ -22,6 +23,8 @@ namespace Vivium {
 
 			id_generator() : new_counter(0), available(0) {}
 
+			size_t memory_usage() const { return created.capacity() * sizeof(T); }
+
 			// Returns if the next ID generated will be a recycled ID
 			bool will_next_be_recycled() {
 				return available > 0;
@@ -60,6 +63,29 @@ namespace Vivium {
 				++available;
 				std::swap(created[id], next);
 			}
+
+			// Write full state, including the implicit free list
+			void serialize(std::ostream& stream) const {
+				write_raw(stream, static_cast<uint32_t>(created.size()));
+				stream.write(reinterpret_cast<const char*>(created.data()), created.size() * sizeof(T));
+
+				write_raw(stream, available);
+				write_raw(stream, next);
+				write_raw(stream, new_counter);
+			}
+
+			bool deserialize(std::istream& stream) {
+				uint32_t created_count = 0;
+
+				if (!read_raw(stream, created_count)) return false;
+
+				created.resize(created_count);
+
+				return stream.read(reinterpret_cast<char*>(created.data()), created.size() * sizeof(T))
+					&& read_raw(stream, available)
+					&& read_raw(stream, next)
+					&& read_raw(stream, new_counter);
+			}
 		};
 	}
 }
\ No newline at end of file
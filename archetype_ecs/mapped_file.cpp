@@ -0,0 +1,155 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Vivium {
+	namespace ECS {
+#ifdef _WIN32
+		mapped_file_t::mapped_file_t()
+			: m_data(nullptr), m_size(0), m_file(nullptr), m_mapping(nullptr) {}
+#else
+		mapped_file_t::mapped_file_t()
+			: m_data(nullptr), m_size(0) {}
+#endif
+
+		mapped_file_t::~mapped_file_t()
+		{
+			close();
+		}
+
+		bool mapped_file_t::open(const char* path)
+		{
+			close();
+
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+			if (file == INVALID_HANDLE_VALUE) return false;
+
+			LARGE_INTEGER file_size;
+
+			if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+				CloseHandle(file);
+
+				return false;
+			}
+
+			// Write copy gives us private pages on first write
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+
+			if (mapping == nullptr) {
+				CloseHandle(file);
+
+				return false;
+			}
+
+			void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+
+			if (view == nullptr) {
+				CloseHandle(mapping);
+				CloseHandle(file);
+
+				return false;
+			}
+
+			m_file = file;
+			m_mapping = mapping;
+			m_data = static_cast<uint8_t*>(view);
+			m_size = static_cast<size_t>(file_size.QuadPart);
+#else
+			int file = ::open(path, O_RDONLY);
+
+			if (file < 0) return false;
+
+			struct stat file_stat;
+
+			if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+				::close(file);
+
+				return false;
+			}
+
+			// Private mapping gives us private pages on first write
+			void* view = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+
+			// Mapping holds its own reference to the file
+			::close(file);
+
+			if (view == MAP_FAILED) return false;
+
+			m_data = static_cast<uint8_t*>(view);
+			m_size = static_cast<size_t>(file_stat.st_size);
+#endif
+
+			return true;
+		}
+
+		void mapped_file_t::close()
+		{
+			if (m_data == nullptr) return;
+
+#ifdef _WIN32
+			UnmapViewOfFile(m_data);
+			CloseHandle(m_mapping);
+			CloseHandle(m_file);
+
+			m_file = nullptr;
+			m_mapping = nullptr;
+#else
+			munmap(m_data, m_size);
+#endif
+
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		bool mapped_file_t::is_open() const { return m_data != nullptr; }
+
+		uint8_t* mapped_file_t::data() const { return m_data; }
+
+		size_t mapped_file_t::size() const { return m_size; }
+
+		memory_streambuf_t::memory_streambuf_t(const uint8_t* data, size_t size)
+		{
+			// Buffer is only ever read from
+			char* begin = reinterpret_cast<char*>(const_cast<uint8_t*>(data));
+
+			setg(begin, begin, begin + size);
+		}
+
+		memory_streambuf_t::pos_type memory_streambuf_t::seekoff(off_type offset, std::ios_base::seekdir direction, [[maybe_unused]] std::ios_base::openmode which)
+		{
+			char* target = nullptr;
+
+			switch (direction) {
+			case std::ios_base::beg: target = eback() + offset; break;
+			case std::ios_base::cur: target = gptr() + offset;	break;
+			case std::ios_base::end: target = egptr() + offset; break;
+			default: return pos_type(off_type(-1));
+			}
+
+			if (target < eback() || target > egptr())
+				return pos_type(off_type(-1));
+
+			setg(eback(), target, egptr());
+
+			return pos_type(target - eback());
+		}
+
+		memory_streambuf_t::pos_type memory_streambuf_t::seekpos(pos_type position, std::ios_base::openmode which)
+		{
+			return seekoff(off_type(position), std::ios_base::beg, which);
+		}
+	}
+}
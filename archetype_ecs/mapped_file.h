@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <streambuf>
+#include <ios>
+
+namespace Vivium {
+	namespace ECS {
+		// File mapped copy-on-write, writes are private to this mapping and
+		// never reach the file, unwritten pages are shared between processes
+		struct mapped_file_t {
+		private:
+			uint8_t* m_data;
+			size_t m_size;
+
+#ifdef _WIN32
+			void* m_file;
+			void* m_mapping;
+#endif
+
+		public:
+			mapped_file_t();
+			~mapped_file_t();
+
+			mapped_file_t(const mapped_file_t&) = delete;
+			mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+			// Returns false if the file couldn't be mapped
+			bool open(const char* path);
+			void close();
+
+			bool is_open() const;
+			uint8_t* data() const;
+			size_t size() const;
+		};
+
+		// Read-only stream buffer over a block of memory, supports seeking
+		// so the position within the memory can be recovered with tellg
+		struct memory_streambuf_t : std::streambuf {
+			memory_streambuf_t(const uint8_t* data, size_t size);
+
+		protected:
+			pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+			pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+		};
+	}
+}
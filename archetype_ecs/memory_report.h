@@ -0,0 +1,89 @@
+#pragma once
+
+#include "constants.h"
+#include "signature.h"
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+namespace Vivium {
+	namespace ECS {
+		// Bytes held by the components of one type in a column or pool
+		struct column_memory_t {
+			component_id_t component_id = COMPONENT_NULL_ID;
+			// Components stored
+			uint32_t count = 0;
+			// Bytes taken by the stored components
+			size_t live_bytes = 0;
+			// Bytes allocated, zero for columns pointing into a mapped snapshot
+			size_t reserved_bytes = 0;
+
+			// Allocated but holding no component, capacity minus size
+			size_t unused_bytes() const { return reserved_bytes > live_bytes ? reserved_bytes - live_bytes : 0; }
+		};
+
+		struct archetype_memory_t {
+			signature_t signature;
+			uint32_t rows = 0;
+			// The archetype itself, including the fixed block of per component data for
+			// every possible component, plus its entity list, enabled bits and column ids
+			size_t overhead_bytes = 0;
+			std::vector<column_memory_t> columns;
+		};
+
+		struct sparse_pool_memory_t {
+			column_memory_t column;
+			// The pool itself, its entity list and entity index pages
+			size_t overhead_bytes = 0;
+			uint32_t index_pages = 0;
+		};
+
+		struct id_generator_memory_t {
+			// Ids handed out at some point, in use or waiting to be recycled
+			uint32_t created = 0;
+			// Length of the free list, ids waiting to be recycled
+			uint32_t available = 0;
+			size_t bytes = 0;
+		};
+
+		// Where the memory of a registry goes. Gathered from sizes and capacities
+		// without touching component data, so cheap enough to sample regularly
+		struct memory_report_t {
+			std::vector<archetype_memory_t> archetypes;
+			std::vector<archetype_memory_t> prefabs;
+			std::vector<sparse_pool_memory_t> sparse_pools;
+			// Totals per registered component over archetypes, prefabs and pools,
+			// indexed by component id
+			std::vector<column_memory_t> components;
+
+			// Entity lookup, from entity id to archetype row
+			size_t entity_lookup_bytes = 0;
+			uint32_t entity_lookup_pages = 0;
+
+			id_generator_memory_t entity_ids;
+			id_generator_memory_t component_ids;
+
+			// Everything counted above
+			size_t total_bytes() const {
+				size_t bytes = entity_lookup_bytes + entity_ids.bytes + component_ids.bytes;
+
+				for (const std::vector<archetype_memory_t>* list : { &archetypes, &prefabs }) {
+					for (const archetype_memory_t& archetype : *list) {
+						bytes += archetype.overhead_bytes;
+
+						for (const column_memory_t& column : archetype.columns) {
+							bytes += column.reserved_bytes;
+						}
+					}
+				}
+
+				for (const sparse_pool_memory_t& pool : sparse_pools) {
+					bytes += pool.overhead_bytes + pool.column.reserved_bytes;
+				}
+
+				return bytes;
+			}
+		};
+	}
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <array>
+#include <climits>
 #include <cstdint>
 #include <set>
+#include <vector>
 
 #include "error_handler.h"
 
@@ -17,7 +19,10 @@ namespace Vivium {
 				std::array<T, page_size> data;
 				
 				page_t(uint32_t start_index)
-					: start_index(start_index), size(0) {}
+					: start_index(start_index), size(0)
+				{
+					data.fill(null_value);
+				}
 				page_t()
 					: start_index(UINT_MAX), size(UINT_MAX) {}
 
@@ -35,7 +40,7 @@ namespace Vivium {
 
 			std::vector<page_t> m_pages;
 
-			uint32_t m_get_page_index_linear(uint32_t start_index) {
+			uint32_t m_get_page_index_linear(uint32_t start_index) const {
 				for (uint32_t page_index = 0; page_index < m_pages.size(); page_index++) {
 					if (m_pages[page_index].start_index == start_index)
 						return page_index;
@@ -76,7 +81,7 @@ namespace Vivium {
 				return new_page_index;
 			}
 
-			uint32_t m_get_page_index(uint32_t start_index) {
+			uint32_t m_get_page_index(uint32_t start_index) const {
 				// TODO: should throw error
 				if (m_pages.empty())		return UINT_MAX;
 				if (m_pages.size() < 10)	return m_get_page_index_linear(start_index);
@@ -136,6 +141,15 @@ namespace Vivium {
 				}
 			}
 
+			// Drop empty pages and give back unused page slots
+			void shrink_to_fit() {
+				shrink_to_size();
+				m_pages.shrink_to_fit();
+			}
+
+			size_t memory_usage() const { return m_pages.capacity() * sizeof(page_t); }
+			uint32_t page_count() const { return static_cast<uint32_t>(m_pages.size()); }
+
 			void push(uint32_t index, const T& value) {
 				uint32_t start_index = index / page_size * page_size;
 				uint32_t page_index = m_get_page_index(start_index);
@@ -169,7 +183,7 @@ namespace Vivium {
 				}
 			}
 
-			const T& at(uint32_t index) const {
+			T at(uint32_t index) const {
 				uint32_t start_index = index / page_size * page_size;
 				uint32_t page_index = m_get_page_index(start_index);
 
@@ -177,7 +191,7 @@ namespace Vivium {
 					return null_value;
 				}
 
-				page_t& page = m_pages[page_index];
+				const page_t& page = m_pages[page_index];
 
 				return page.data[index - start_index];
 			}
@@ -186,9 +200,7 @@ namespace Vivium {
 				uint32_t start_index = index / page_size * page_size;
 				uint32_t page_index = m_get_page_index(start_index);
 
-				if (page_index == UINT_MAX) {
-					VIVIUM_ECS_ERROR(FATAL, "Attempted to access element that didn't exist with at");
-				}
+				VIVIUM_ECS_CHECK(page_index != UINT_MAX, FATAL, "Attempted to access element that didn't exist with at");
 
 				page_t& page = m_pages[page_index];
 
@@ -0,0 +1,122 @@
+#include "profiling.h"
+
+namespace Vivium {
+	namespace ECS {
+		namespace profiling {
+			namespace {
+				const trace_clock_t::time_point epoch = trace_clock_t::now();
+
+				// Chrome traces use microseconds
+				void write_microseconds(std::ostream& stream, uint64_t nanoseconds) {
+					stream << nanoseconds / 1000 << "." << (nanoseconds % 1000) / 100 << (nanoseconds % 100) / 10 << nanoseconds % 10;
+				}
+
+				void write_string(std::ostream& stream, const char* string) {
+					stream << "\"";
+
+					for (; *string != '\0'; string++) {
+						if (*string == '"' || *string == '\\') stream << '\\';
+
+						stream << *string;
+					}
+
+					stream << "\"";
+				}
+			}
+
+			const char* counter_to_string(counter id) {
+				switch (id) {
+				case ARCHETYPE_CREATIONS:	return "archetype_creations";
+				case ROW_MOVES:				return "row_moves";
+				case COLUMN_REALLOCATIONS:	return "column_reallocations";
+				case SPARSE_LOOKUPS:		return "sparse_lookups";
+				case QUERIES:				return "queries";
+				default:					return "unknown";
+				}
+			}
+
+			uint64_t now() {
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(trace_clock_t::now() - epoch).count();
+			}
+
+			void record(counter id, const char* name, uint64_t start, uint64_t end) {
+				++current_counters.counts[id];
+				current_counters.nanoseconds[id] += end - start;
+
+				if (trace_events.size() < max_trace_events) {
+					trace_events.push_back(trace_event_t{ id, name, start, end - start });
+				}
+			}
+
+			void begin_frame() {
+				last_counters = current_counters;
+				current_counters = frame_counters_t();
+
+				if (frame_history.size() < max_trace_events) {
+					frame_history.push_back({ now(), last_counters });
+				}
+			}
+
+			const frame_counters_t& current_frame() {
+				return current_counters;
+			}
+
+			const frame_counters_t& last_frame() {
+				return last_counters;
+			}
+
+			void clear() {
+				current_counters = frame_counters_t();
+				last_counters = frame_counters_t();
+
+				frame_history.clear();
+				trace_events.clear();
+			}
+
+			bool write_chrome_trace(std::ostream& stream) {
+				stream << "{\"traceEvents\":[";
+
+				bool first = true;
+
+				auto separate = [&]() {
+					if (!first) stream << ",";
+
+					first = false;
+				};
+
+				for (const trace_event_t& event : trace_events) {
+					separate();
+
+					stream << "\n{\"name\":";
+					write_string(stream, event.name);
+					stream << ",\"cat\":\"" << counter_to_string(event.category)
+						<< "\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":";
+					write_microseconds(stream, event.start);
+					stream << ",\"dur\":";
+					write_microseconds(stream, event.duration);
+					stream << "}";
+				}
+
+				for (const auto& [timestamp, counters] : frame_history) {
+					separate();
+
+					stream << "\n{\"name\":\"frame\",\"ph\":\"C\",\"pid\":0,\"tid\":0,\"ts\":";
+					write_microseconds(stream, timestamp);
+					stream << ",\"args\":{";
+
+					for (uint32_t i = 0; i < COUNTER_COUNT; i++) {
+						if (i != 0) stream << ",";
+
+						stream << "\"" << counter_to_string(static_cast<counter>(i)) << "\":" << counters.counts[i];
+					}
+
+					stream << "}}";
+				}
+
+				stream << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+				return static_cast<bool>(stream);
+			}
+		}
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// Instrumentation is compiled out unless VIVIUM_ECS_PROFILING is defined, in which
+// case structural changes, lookups and queries are counted, and the expensive ones
+// timed and recorded as trace events. Not thread safe, like the rest of the registry
+
+namespace Vivium {
+	namespace ECS {
+		namespace profiling {
+			enum counter : uint32_t {
+				ARCHETYPE_CREATIONS,
+				ROW_MOVES,
+				COLUMN_REALLOCATIONS,
+				SPARSE_LOOKUPS,
+				QUERIES,
+				COUNTER_COUNT
+			};
+
+			const char* counter_to_string(counter id);
+
+			struct frame_counters_t {
+				std::array<uint64_t, COUNTER_COUNT> counts = {};
+				// Only accumulated for timed counters
+				std::array<uint64_t, COUNTER_COUNT> nanoseconds = {};
+			};
+
+			struct trace_event_t {
+				counter category;
+				const char* name;
+
+				// Relative to the first event, in nanoseconds
+				uint64_t start;
+				uint64_t duration;
+			};
+
+			using trace_clock_t = std::chrono::steady_clock;
+
+			inline frame_counters_t current_counters;
+			inline frame_counters_t last_counters;
+			// Counters of each completed frame, written as counter events in traces
+			inline std::vector<std::pair<uint64_t, frame_counters_t>> frame_history;
+
+			inline std::vector<trace_event_t> trace_events;
+			// Events past this are only counted, so a long session can't exhaust memory
+			inline uint32_t max_trace_events = 1 << 20;
+
+			inline void count(counter id, uint64_t amount = 1) {
+				current_counters.counts[id] += amount;
+			}
+
+			// Time since instrumentation started, in nanoseconds
+			uint64_t now();
+
+			void record(counter id, const char* name, uint64_t start, uint64_t end);
+
+			// End the current frame, its counters become last_frame()
+			void begin_frame();
+
+			const frame_counters_t& current_frame();
+			const frame_counters_t& last_frame();
+
+			// Discard all counters, frames and trace events
+			void clear();
+
+			// Write recorded events and per-frame counters in the Chrome trace event format,
+			// viewable in chrome://tracing or Perfetto
+			bool write_chrome_trace(std::ostream& stream);
+
+			// Counts and times the enclosing scope
+			struct scope_t {
+			private:
+				counter m_counter;
+				const char* m_name;
+				uint64_t m_start;
+
+			public:
+				scope_t(counter id, const char* name)
+					: m_counter(id), m_name(name), m_start(now()) {}
+
+				~scope_t() {
+					record(m_counter, m_name, m_start, now());
+				}
+
+				scope_t(const scope_t&) = delete;
+				scope_t& operator=(const scope_t&) = delete;
+			};
+		}
+	}
+}
+
+#define VIVIUM_ECS_CONCAT_IMPL(_a, _b) _a##_b
+#define VIVIUM_ECS_CONCAT(_a, _b) VIVIUM_ECS_CONCAT_IMPL(_a, _b)
+
+#ifdef VIVIUM_ECS_PROFILING
+#define VIVIUM_ECS_PROFILE_COUNT(_counter) \
+	Vivium::ECS::profiling::count(Vivium::ECS::profiling::_counter)
+#define VIVIUM_ECS_PROFILE_ADD(_counter, _amount) \
+	Vivium::ECS::profiling::count(Vivium::ECS::profiling::_counter, _amount)
+#define VIVIUM_ECS_PROFILE_SCOPE(_counter, _name) \
+	Vivium::ECS::profiling::scope_t VIVIUM_ECS_CONCAT(vivium_ecs_profile_scope_, __LINE__)( \
+		Vivium::ECS::profiling::_counter, _name)
+#else
+#define VIVIUM_ECS_PROFILE_COUNT(_counter) ((void)0)
+#define VIVIUM_ECS_PROFILE_ADD(_counter, _amount) ((void)0)
+#define VIVIUM_ECS_PROFILE_SCOPE(_counter, _name) ((void)0)
+#endif
@@ -1,9 +1,68 @@
 #include "registry.h"
 #include "archetype.h"
 
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
 namespace Vivium {
 	namespace ECS {
+		namespace {
+			column_memory_t describe_column(component_id_t component_id, const component_array_t& components) {
+				column_memory_t column;
+
+				column.component_id = component_id;
+				column.count = components.size();
+				column.live_bytes = static_cast<size_t>(components.size()) * components.get_manager().size;
+				column.reserved_bytes = components.memory_usage();
+
+				return column;
+			}
+
+			// Adds each column to the totals of its component
+			void add_to_totals(const column_memory_t& column, std::vector<column_memory_t>& totals) {
+				column_memory_t& total = totals[column.component_id];
+
+				total.count += column.count;
+				total.live_bytes += column.live_bytes;
+				total.reserved_bytes += column.reserved_bytes;
+			}
+
+			void describe_archetype(const archetype_t& archetype, archetype_memory_t& memory, std::vector<column_memory_t>& totals) {
+				memory.signature = archetype.signature;
+				memory.rows = archetype.size;
+				memory.overhead_bytes = archetype.memory_usage();
+				memory.columns.clear();
+
+				for (component_id_t i : archetype.component_ids) {
+					column_memory_t column = describe_column(i, archetype.arrays[i].components);
+
+					memory.overhead_bytes -= column.reserved_bytes;
+					memory.columns.push_back(column);
+
+					add_to_totals(column, totals);
+				}
+			}
+
+			// Reserves room for at least required elements, growing by three halves like
+			// component arrays do, so repeated small batches don't reallocate every time
+			template <typename container_t>
+			void reserve_geometric(container_t& container, size_t required) {
+				if (required <= container.capacity()) return;
+
+				size_t three_halfs_factor = container.capacity() + (container.capacity() >> 1) + 1;
+
+				container.reserve(static_cast<uint32_t>(std::max(three_halfs_factor, required)));
+			}
+
+			template <typename T, uint32_t max_ids, T null_value>
+			id_generator_memory_t describe_ids(const id_generator<T, max_ids, null_value>& generator) {
+				return id_generator_memory_t{ static_cast<uint32_t>(generator.created.size()), generator.available, generator.memory_usage() };
+			}
+		}
+
 		id_generator<registry_id_t, MAX_REGISTRIES, REGISTRY_NULL_ID> registry_t::m_registry_gen;
+		archetype_t registry_t::m_empty_archetype;
 
 		entity_value_t registry_t::m_entity_id_getter(const entity_t& entity) {
 			return entity.value;
@@ -20,7 +79,45 @@ namespace Vivium {
 			return nullptr;
 		}
 
-		registry_t::registry_t()
+		void registry_t::m_set_entity_index(entity_value_t entity, uint32_t index) {
+			if (entity != ENTITY_NULL)
+				m_entity_sparse.at(entity).index = index;
+		}
+
+		archetype_t* registry_t::m_create_archetype(signature_t signature) {
+			VIVIUM_ECS_PROFILE_SCOPE(ARCHETYPE_CREATIONS, "create_archetype");
+
+			auto cond_pair = m_archetypes.insert({ signature, archetype_t() });
+			archetype_t& new_archetype = cond_pair.first->second;
+
+			if (!cond_pair.second) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to create archetype for signature that already had an archetype");
+
+				return &new_archetype;
+			}
+
+			m_init_archetype(new_archetype, signature);
+
+			return &new_archetype;
+		}
+
+		registry_t::prefab_archetype_t& registry_t::m_create_prefab_archetype(signature_t signature) {
+			prefab_archetype_t& prefab = m_prefabs[signature];
+
+			m_init_archetype(prefab.storage, signature);
+
+			return prefab;
+		}
+
+		void registry_t::m_init_archetype(archetype_t& archetype, signature_t signature) const {
+			archetype.m_set_signature(signature, m_tags);
+
+			for (component_id_t i : archetype.component_ids) {
+				archetype.arrays[i].components = component_array_t(m_component_managers[i]);
+			}
+		}
+
+		registry_t::registry_t(limits_tag_t)
 			: m_id(m_registry_gen.get())
 		{}
 		
@@ -29,6 +126,11 @@ namespace Vivium {
 				archetype.m_clear();
 			}
 
+			// Release our component ids, since our registry id will be recycled
+			for (uint32_t i = 0; i < m_component_gen.new_counter; i++) {
+				m_component_registrations[i].unregister_component(m_id);
+			}
+
 			m_registry_gen.free(m_id);
 		}
 
@@ -44,23 +146,1011 @@ namespace Vivium {
 			return new_entity.value;
 		}
 
-		void registry_t::free_entity(entity_value_t entity)
+		void registry_t::m_release_entity(entity_value_t entity)
 		{
-			clear_entity(entity);
+			// Id will be reused, so it can't be left in any relation
+			for (relation_storage_t& relation : m_relations) {
+				relation.remove_entity(entity);
+			}
 
 			m_entity_sparse.erase(entity);
 
 			m_entity_gen.free(entity);
 		}
 
+		void registry_t::free_entity(entity_value_t entity)
+		{
+			clear_entity(entity);
+			m_release_entity(entity);
+		}
+
+		bool registry_t::m_is_prefab(const entity_t& entity) const
+		{
+			if (entity.archetype == nullptr) return false;
+
+			auto it = m_prefabs.find(entity.archetype->signature);
+
+			return it != m_prefabs.end() && &it->second.storage == entity.archetype;
+		}
+
+		component_id_t registry_t::m_map_component(const registry_t& source, component_id_t component_id) const
+		{
+			return source.m_component_registrations[component_id].get_id(m_id);
+		}
+
+		bool registry_t::m_map_signature(const registry_t& source, const signature_t& signature, signature_t& mapped) const
+		{
+			mapped.enabled.reset();
+
+			for (component_id_t i = 0; i < source.m_component_gen.new_counter; i++) {
+				if (!signature.enabled.test(i)) continue;
+
+				component_id_t component_id = m_map_component(source, i);
+
+				if (component_id == COMPONENT_NULL_ID) return false;
+
+				mapped.enabled.set(component_id, true);
+			}
+
+			return true;
+		}
+
+		std::vector<entity_value_t> registry_t::merge_from(registry_t& source)
+		{
+			if (&source == this) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to merge registry into itself");
+
+				return {};
+			}
+
+			// Check every component in use can be mapped before anything is moved
+			std::vector<std::pair<archetype_t*, signature_t>> archetypes;
+
+			for (auto& [signature, archetype] : source.m_archetypes) {
+				if (archetype.size == 0) continue;
+
+				signature_t mapped;
+
+				if (!m_map_signature(source, signature, mapped)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to merge registry with components that aren't registered here");
+
+					return {};
+				}
+
+				archetypes.push_back({ &archetype, mapped });
+			}
+
+			for (component_id_t i : source.m_sparse_ids) {
+				if (source.m_sparse_pools[i]->size() != 0 && m_map_component(source, i) == COMPONENT_NULL_ID) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to merge registry with components that aren't registered here");
+
+					return {};
+				}
+			}
+
+			// New value of each entity, prefab rows aren't moved
+			std::vector<entity_value_t> entity_map(source.m_entity_gen.created.size(), ENTITY_NULL);
+			std::vector<entity_value_t> moved;
+
+			moved.reserve(source.m_entity_sparse.size());
+
+			for (auto& [source_archetype, signature] : archetypes) {
+				archetype_t* destination = m_get_archetype(signature);
+
+				if (destination == nullptr)
+					destination = m_create_archetype(signature);
+
+				for (component_id_t i : source_archetype->component_ids) {
+					source_archetype->arrays[i].components.append_all_to(
+						destination->arrays[m_map_component(source, i)].components
+					);
+				}
+
+				// Entities are created already pointing at their row, so they're never looked up
+				for (uint32_t row = 0; row < source_archetype->size; row++) {
+					entity_t entity;
+
+					entity.value = m_entity_gen.get();
+					entity.archetype = destination;
+					entity.index = destination->size + row;
+
+					m_entity_sparse.push(entity);
+					destination->m_push_row(entity.value, source_archetype->is_row_enabled(row));
+
+					entity_map[source_archetype->entities[row]] = entity.value;
+					moved.push_back(source_archetype->entities[row]);
+				}
+
+				destination->size += source_archetype->size;
+
+				source_archetype->m_resize_rows(0);
+				source_archetype->size = 0;
+			}
+
+			// Entities with only sparse components, or none at all
+			for (const entity_t& entity : source.m_entity_sparse) {
+				if (entity.archetype == nullptr) {
+					entity_map[entity.value] = get_entity();
+					moved.push_back(entity.value);
+				}
+			}
+
+			for (component_id_t i : source.m_sparse_ids) {
+				if (source.m_sparse_pools[i]->size() != 0)
+					source.m_sparse_pools[i]->append_all_to(*m_sparse_pools[m_map_component(source, i)], entity_map.data());
+			}
+
+			// Relation ids are shared by every registry, only the entities need mapping
+			if (m_relations.size() < source.m_relations.size())
+				m_relations.resize(source.m_relations.size());
+
+			for (uint32_t i = 0; i < source.m_relations.size(); i++) {
+				for (const auto& [from, targets] : source.m_relations[i].targets) {
+					for (entity_value_t target : targets) {
+						if (entity_map[from] != ENTITY_NULL && entity_map[target] != ENTITY_NULL)
+							m_relations[i].add(entity_map[from], entity_map[target]);
+					}
+				}
+			}
+
+			// Without prefabs left behind, lookups and relations of source can be dropped at once
+			if (moved.size() == source.m_entity_sparse.size()) {
+				source.m_entity_sparse.clear();
+
+				for (entity_value_t entity : moved) {
+					source.m_entity_gen.free(entity);
+				}
+
+				for (relation_storage_t& relation : source.m_relations) {
+					relation = relation_storage_t();
+				}
+			}
+			else {
+				for (entity_value_t entity : moved) {
+					source.m_release_entity(entity);
+				}
+			}
+
+			return entity_map;
+		}
+
+		entity_value_t registry_t::transfer(entity_value_t entity_id, registry_t& destination)
+		{
+			entity_t& entity = m_entity_sparse.at(entity_id);
+
+			if (&destination == this || m_is_prefab(entity)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to transfer entity {} to its own registry, or a prefab", entity_id);
+
+				return ENTITY_NULL;
+			}
+
+			signature_t signature;
+
+			if (entity.archetype != nullptr && !destination.m_map_signature(*this, entity.archetype->signature, signature)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to transfer entity {} with components not registered in destination", entity_id);
+
+				return ENTITY_NULL;
+			}
+
+			for (component_id_t i : m_sparse_ids) {
+				if (m_sparse_pools[i]->contains(entity_id) && destination.m_map_component(*this, i) == COMPONENT_NULL_ID) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to transfer entity {} with components not registered in destination", entity_id);
+
+					return ENTITY_NULL;
+				}
+			}
+
+			entity_value_t new_entity_id = destination.get_entity();
+
+			if (entity.archetype != nullptr) {
+				archetype_t& source = *entity.archetype;
+				archetype_t* target = destination.m_get_archetype(signature);
+
+				if (target == nullptr)
+					target = destination.m_create_archetype(signature);
+
+				for (component_id_t i : source.component_ids) {
+					source.arrays[i].components.transfer_index_to_end_of(
+						entity.index, target->arrays[destination.m_map_component(*this, i)].components
+					);
+				}
+
+				entity_t& new_entity = destination.m_entity_sparse.at(new_entity_id);
+
+				new_entity.archetype = target;
+				new_entity.index = target->size++;
+
+				target->m_push_row(new_entity_id, source.is_row_enabled(entity.index));
+
+				m_set_entity_index(source.m_remove_row(entity.index), entity.index);
+				--source.size;
+
+				entity.archetype = nullptr;
+				entity.index = INVALID_INDEX;
+			}
+
+			for (component_id_t i : m_sparse_ids) {
+				if (m_sparse_pools[i]->contains(entity_id))
+					m_sparse_pools[i]->transfer_to(entity_id, *destination.m_sparse_pools[destination.m_map_component(*this, i)], new_entity_id);
+			}
+
+			m_release_entity(entity_id);
+
+			return new_entity_id;
+		}
+
 		void registry_t::clear_entity(entity_value_t entity_id)
 		{
 			entity_t& entity = m_entity_sparse.at(entity_id);
 
+			bool had_sparse = false;
+
+			for (component_id_t i : m_sparse_ids) {
+				had_sparse |= m_sparse_pools[i]->erase(entity_id);
+			}
+
+			if (entity.archetype != nullptr) {
+				uint32_t index = entity.index;
+
+				m_set_entity_index(entity.archetype->remove_entity(entity), index);
+			}
+			else if (!had_sparse)
+				VIVIUM_ECS_ERROR(severity::WARN, "Attempted to clear entity with no components");
+		}
+
+		void registry_t::set_enabled(entity_value_t entity_id, bool enabled)
+		{
+			const entity_t& entity = m_entity_sparse.at(entity_id);
+
 			if (entity.archetype != nullptr)
-				entity.archetype->remove_entity(entity);
+				entity.archetype->set_row_enabled(entity.index, enabled);
 			else
-				VIVIUM_ECS_ERROR(severity::WARN, "Attempted to clear entity with no components");
+				VIVIUM_ECS_ERROR(severity::WARN, "Attempted to enable or disable entity with no archetype components");
+		}
+
+		bool registry_t::is_enabled(entity_value_t entity_id) const
+		{
+			const entity_t& entity = m_entity_sparse.at(entity_id);
+
+			return entity.archetype == nullptr || entity.archetype->is_row_enabled(entity.index);
+		}
+
+		void registry_t::m_sort_hierarchy(const relation_storage_t& relation)
+		{
+			// Roots have depth 0, found by following parents until reaching a known depth
+			std::unordered_map<entity_value_t, uint32_t> depths;
+			std::vector<entity_value_t> path;
+
+			auto depth_of = [&](entity_value_t entity) {
+				path.clear();
+
+				uint32_t depth = 0;
+
+				while (true) {
+					if (auto known = depths.find(entity); known != depths.end()) {
+						depth = known->second;
+
+						break;
+					}
+
+					auto parent = relation.targets.find(entity);
+
+					if (parent == relation.targets.end())
+						break;
+
+					if (path.size() > relation.targets.size()) {
+						VIVIUM_ECS_ERROR(severity::ERROR, "Hierarchy has a cycle through entity {}", entity);
+
+						break;
+					}
+
+					path.push_back(entity);
+					entity = parent->second.front();
+				}
+
+				// Walked from child towards root, so assign depths on the way back
+				for (auto it = path.rbegin(); it != path.rend(); ++it) {
+					depths[*it] = ++depth;
+				}
+
+				return depth;
+			};
+
+			// Only archetypes holding a child can be out of order
+			std::unordered_set<archetype_t*> archetypes;
+
+			for (const auto& [child, parents] : relation.targets) {
+				const entity_t& entity = m_entity_sparse.at(child);
+
+				if (entity.archetype != nullptr)
+					archetypes.insert(entity.archetype);
+			}
+
+			std::vector<uint32_t> row_depths;
+			std::vector<uint32_t> order;
+
+			for (archetype_t* archetype : archetypes) {
+				row_depths.resize(archetype->size);
+
+				bool sorted = true;
+
+				for (uint32_t row = 0; row < archetype->size; row++) {
+					row_depths[row] = depth_of(archetype->entities[row]);
+
+					if (row > 0 && row_depths[row] < row_depths[row - 1])
+						sorted = false;
+				}
+
+				if (sorted) continue;
+
+				// Stable, so rows at the same depth keep their relative order
+				order.resize(archetype->size);
+				std::iota(order.begin(), order.end(), 0);
+				std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+					return row_depths[a] < row_depths[b];
+				});
+
+				archetype->m_reorder_rows(order.data(), *this);
+			}
+		}
+
+		std::vector<entity_value_t> registry_t::instantiate(entity_value_t prefab_id, uint32_t count)
+		{
+			std::vector<entity_value_t> instances;
+
+			const entity_t& prefab_entity = m_entity_sparse.at(prefab_id);
+
+			auto it = prefab_entity.archetype != nullptr
+				? m_prefabs.find(prefab_entity.archetype->signature) : m_prefabs.end();
+
+			if (it == m_prefabs.end() || &it->second.storage != prefab_entity.archetype) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to instantiate entity {} which isn't a prefab", prefab_id);
+
+				return instances;
+			}
+
+			prefab_archetype_t& prefab = it->second;
+
+			// Resolve instance archetype once per prefab archetype
+			if (prefab.target == nullptr) {
+				prefab.target = m_get_archetype(prefab.storage.signature);
+
+				if (prefab.target == nullptr)
+					prefab.target = m_create_archetype(prefab.storage.signature);
+			}
+
+			archetype_t& target = *prefab.target;
+			uint32_t first_index = target.size;
+
+			for (component_id_t component_id : prefab.storage.component_ids) {
+				target.arrays[component_id].components.append_clones(
+					prefab.storage.arrays[component_id].components,
+					prefab_entity.index,
+					count
+				);
+			}
+
+			target.size += count;
+
+			instances.reserve(count);
+			reserve_geometric(target.entities, target.entities.size() + count);
+			reserve_geometric(target.enabled_rows, (target.entities.size() + count + 63) / 64);
+			reserve_geometric(m_entity_sparse, m_entity_sparse.size() + count);
+
+			for (uint32_t i = 0; i < count; i++) {
+				entity_t entity;
+				entity.value = m_entity_gen.get();
+				entity.archetype = &target;
+				entity.index = first_index + i;
+
+				m_entity_sparse.push(entity);
+				target.m_push_row(entity.value, true);
+				instances.push_back(entity.value);
+			}
+
+			return instances;
+		}
+
+		memory_report_t registry_t::memory_report() const
+		{
+			memory_report_t report;
+
+			memory_report(report);
+
+			return report;
+		}
+
+		void registry_t::memory_report(memory_report_t& report) const
+		{
+			report.components.assign(m_component_gen.created.size(), column_memory_t());
+
+			for (component_id_t i = 0; i < report.components.size(); i++) {
+				report.components[i].component_id = i;
+			}
+
+			report.archetypes.resize(m_archetypes.size());
+			report.prefabs.resize(m_prefabs.size());
+			report.sparse_pools.clear();
+
+			uint32_t index = 0;
+
+			for (const auto& [signature, archetype] : m_archetypes) {
+				describe_archetype(archetype, report.archetypes[index++], report.components);
+			}
+
+			index = 0;
+
+			for (const auto& [signature, prefab] : m_prefabs) {
+				describe_archetype(prefab.storage, report.prefabs[index++], report.components);
+			}
+
+			for (component_id_t i : m_sparse_ids) {
+				const sparse_pool_t& pool = *m_sparse_pools[i];
+
+				sparse_pool_memory_t memory;
+
+				memory.column = describe_column(i, pool.components);
+				memory.overhead_bytes = pool.memory_usage() - memory.column.reserved_bytes;
+				memory.index_pages = pool.index_page_count();
+
+				add_to_totals(memory.column, report.components);
+
+				report.sparse_pools.push_back(memory);
+			}
+
+			report.entity_lookup_bytes = m_entity_sparse.memory_usage();
+			report.entity_lookup_pages = m_entity_sparse.page_count();
+
+			report.entity_ids = describe_ids(m_entity_gen);
+			report.component_ids = describe_ids(m_component_gen);
+		}
+
+		size_t registry_t::compact()
+		{
+			size_t reclaimed = 0;
+
+			std::unordered_set<const archetype_t*> removed;
+
+			for (auto it = m_archetypes.begin(); it != m_archetypes.end();) {
+				archetype_t& archetype = it->second;
+
+				if (archetype.size == 0) {
+					reclaimed += archetype.memory_usage();
+					removed.insert(&archetype);
+
+					it = m_archetypes.erase(it);
+				}
+				else {
+					size_t used = archetype.memory_usage();
+					archetype.shrink_to_fit();
+					reclaimed += used - archetype.memory_usage();
+
+					++it;
+				}
+			}
+
+			// Graph edges and prefab targets are only caches, so edges to deleted
+			// archetypes are cleared and found again the next time they're needed
+			if (!removed.empty()) {
+				auto clear_edges = [&removed](archetype_t& archetype) {
+					for (archetype_t::per_component_data_t& data : archetype.arrays) {
+						if (removed.contains(data.connections.add))
+							data.connections.add = nullptr;
+
+						if (removed.contains(data.connections.remove))
+							data.connections.remove = nullptr;
+					}
+				};
+
+				for (auto& [signature, archetype] : m_archetypes) {
+					clear_edges(archetype);
+				}
+
+				for (auto& [signature, prefab] : m_prefabs) {
+					clear_edges(prefab.storage);
+
+					if (removed.contains(prefab.target))
+						prefab.target = nullptr;
+				}
+			}
+
+			for (auto& [signature, prefab] : m_prefabs) {
+				size_t used = prefab.storage.memory_usage();
+				prefab.storage.shrink_to_fit();
+				reclaimed += used - prefab.storage.memory_usage();
+			}
+
+			for (const std::unique_ptr<sparse_pool_t>& pool : m_sparse_pools) {
+				if (pool == nullptr) continue;
+
+				size_t used = pool->memory_usage();
+				pool->shrink_to_fit();
+				reclaimed += used - pool->memory_usage();
+			}
+
+			size_t used = m_entity_sparse.memory_usage();
+			m_entity_sparse.shrink_to_fit();
+			reclaimed += used - m_entity_sparse.memory_usage();
+
+			return reclaimed;
+		}
+
+		std::unique_ptr<registry_t> registry_t::clone() const
+		{
+			std::unique_ptr<registry_t> copy = std::make_unique<registry_t>();
+
+			copy->m_component_gen = m_component_gen;
+			copy->m_component_managers = m_component_managers;
+			copy->m_component_registrations = m_component_registrations;
+			copy->m_tags = m_tags;
+			copy->m_sparse = m_sparse;
+			copy->m_sparse_ids = m_sparse_ids;
+
+			for (component_id_t i : m_sparse_ids) {
+				copy->m_sparse_pools[i] = std::make_unique<sparse_pool_t>(m_component_managers[i]);
+				copy->m_sparse_pools[i]->clone_from(*m_sparse_pools[i]);
+			}
+
+			// Same component ids, but under the id of the new registry
+			for (uint32_t i = 0; i < m_component_gen.new_counter; i++) {
+				copy->m_component_registrations[i].register_component(copy->m_id, i);
+			}
+
+			std::unordered_map<const archetype_t*, archetype_t*> archetype_map;
+			archetype_map.reserve(m_archetypes.size());
+
+			copy->m_archetypes.reserve(m_archetypes.size());
+
+			// Connections are left empty, they are filled again on first use
+			for (const auto& [signature, archetype] : m_archetypes) {
+				archetype_t* new_archetype = copy->m_create_archetype(signature);
+
+				for (component_id_t i : archetype.component_ids) {
+					new_archetype->arrays[i].components.clone_from(archetype.arrays[i].components);
+				}
+
+				new_archetype->entities = archetype.entities;
+				new_archetype->enabled_rows = archetype.enabled_rows;
+				new_archetype->disabled_count = archetype.disabled_count;
+				new_archetype->size = archetype.size;
+
+				archetype_map.insert({ &archetype, new_archetype });
+			}
+
+			for (const auto& [signature, prefab] : m_prefabs) {
+				prefab_archetype_t& new_prefab = copy->m_create_prefab_archetype(signature);
+
+				for (component_id_t component_id : prefab.storage.component_ids) {
+					new_prefab.storage.arrays[component_id].components.clone_from(
+						prefab.storage.arrays[component_id].components
+					);
+				}
+
+				new_prefab.storage.entities = prefab.storage.entities;
+				new_prefab.storage.enabled_rows = prefab.storage.enabled_rows;
+				new_prefab.storage.disabled_count = prefab.storage.disabled_count;
+				new_prefab.storage.size = prefab.storage.size;
+
+				archetype_map.insert({ &prefab.storage, &new_prefab.storage });
+			}
+
+			copy->m_relations = m_relations;
+			copy->m_resources.resize(m_resources.size());
+
+			for (uint32_t i = 0; i < m_resources.size(); i++) {
+				copy->m_resources[i].clone_from(m_resources[i]);
+			}
+
+			copy->m_entity_gen = m_entity_gen;
+			copy->m_entity_sparse = m_entity_sparse;
+
+			// Point entities at the copied archetypes
+			entity_t* entities = copy->m_entity_sparse.data();
+
+			for (uint32_t i = 0; i < copy->m_entity_sparse.size(); i++) {
+				if (entities[i].archetype != nullptr)
+					entities[i].archetype = archetype_map.at(entities[i].archetype);
+			}
+
+			return copy;
+		}
+
+		bool registry_t::m_save_archetype(std::ostream& stream, const archetype_t& archetype) const
+		{
+			const signature_t& signature = archetype.signature;
+
+			signature.serialize(stream);
+			write_raw(stream, archetype.size);
+
+			stream.write(reinterpret_cast<const char*>(archetype.entities.data()), archetype.size * sizeof(entity_value_t));
+			stream.write(reinterpret_cast<const char*>(archetype.enabled_rows.data()), archetype.enabled_rows.size() * sizeof(uint64_t));
+
+			for (component_id_t i : archetype.component_ids) {
+				// Pad so column starts aligned, only possible if we know our position
+				std::streamoff position = stream.tellp();
+				uint32_t padding = 0;
+
+				if (position >= 0) {
+					position += sizeof(padding);
+					padding = (SNAPSHOT_ALIGNMENT - position % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT;
+				}
+
+				write_raw(stream, padding);
+
+				for (uint32_t byte = 0; byte < padding; byte++) {
+					stream.put(0);
+				}
+
+				if (!archetype.arrays[i].components.serialize(stream)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to serialize component {}", i);
+
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool registry_t::save(std::ostream& stream) const
+		{
+			for (const relation_storage_t& relation : m_relations) {
+				if (!relation.empty()) {
+					VIVIUM_ECS_ERROR(severity::WARN, "Relations aren't written to snapshots");
+
+					break;
+				}
+			}
+
+			write_raw(stream, SNAPSHOT_MAGIC);
+			write_raw(stream, SNAPSHOT_VERSION);
+
+			// Signature width and entity value layout depend on the build's limits
+			write_raw(stream, MAX_COMPONENTS);
+			write_raw(stream, ENTITY_ID_BITS);
+
+			// Only component sizes are stored, loading relies on the same registration order
+			uint32_t component_count = m_component_gen.new_counter;
+			write_raw(stream, component_count);
+
+			for (uint32_t i = 0; i < component_count; i++) {
+				write_raw(stream, m_component_managers[i].size);
+			}
+
+			m_entity_gen.serialize(stream);
+
+			// Archetypes are referred to by the order they were written in
+			std::unordered_map<const archetype_t*, uint32_t> archetype_indices;
+			archetype_indices.reserve(m_archetypes.size());
+
+			write_raw(stream, static_cast<uint32_t>(m_archetypes.size()));
+
+			for (const auto& [signature, archetype] : m_archetypes) {
+				archetype_indices.insert({ &archetype, static_cast<uint32_t>(archetype_indices.size()) });
+
+				if (!m_save_archetype(stream, archetype)) return false;
+			}
+
+			// Prefab archetypes continue the same indices
+			write_raw(stream, static_cast<uint32_t>(m_prefabs.size()));
+
+			for (const auto& [signature, prefab] : m_prefabs) {
+				archetype_indices.insert({ &prefab.storage, static_cast<uint32_t>(archetype_indices.size()) });
+
+				if (!m_save_archetype(stream, prefab.storage)) return false;
+			}
+
+			// Sparse pools are stored like archetypes with a single column
+			write_raw(stream, static_cast<uint32_t>(m_sparse_ids.size()));
+
+			for (component_id_t i : m_sparse_ids) {
+				const sparse_pool_t& pool = *m_sparse_pools[i];
+
+				write_raw(stream, static_cast<uint32_t>(i));
+				write_raw(stream, pool.size());
+
+				stream.write(reinterpret_cast<const char*>(pool.entities.data()), pool.size() * sizeof(entity_value_t));
+
+				if (!pool.components.serialize(stream)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to serialize sparse component {}", i);
+
+					return false;
+				}
+			}
+
+			write_raw(stream, m_entity_sparse.size());
+
+			for (const entity_t& entity : m_entity_sparse) {
+				uint32_t archetype_index = INVALID_INDEX;
+
+				if (entity.archetype != nullptr)
+					archetype_index = archetype_indices.at(entity.archetype);
+
+				write_raw(stream, entity.value);
+				write_raw(stream, archetype_index);
+				write_raw(stream, entity.index);
+			}
+
+			return static_cast<bool>(stream);
+		}
+
+		bool registry_t::load(std::istream& stream)
+		{
+			return m_load(stream, nullptr);
+		}
+
+		bool registry_t::load_mapped(const char* path)
+		{
+			std::unique_ptr<mapped_file_t> mapping = std::make_unique<mapped_file_t>();
+
+			if (!mapping->open(path)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Failed to map snapshot file {}", path);
+
+				return false;
+			}
+
+			memory_streambuf_t buffer(mapping->data(), mapping->size());
+			std::istream stream(&buffer);
+
+			return m_load(stream, std::move(mapping));
+		}
+
+		bool registry_t::m_load_rows(std::istream& stream, archetype_t& archetype, uint32_t size, const mapped_file_t* mapping) const
+		{
+			archetype.m_resize_rows(size);
+
+			if (!stream.read(reinterpret_cast<char*>(archetype.entities.data()), size * sizeof(entity_value_t))
+				|| !stream.read(reinterpret_cast<char*>(archetype.enabled_rows.data()), archetype.enabled_rows.size() * sizeof(uint64_t)))
+			{
+				VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read rows from snapshot");
+
+				return false;
+			}
+
+			// Recount disabled rows
+			archetype.m_resize_rows(size);
+
+			for (component_id_t i : archetype.component_ids) {
+				component_array_t& components = archetype.arrays[i].components;
+				const component_manager_t& manager = m_component_managers[i];
+
+				uint32_t padding = 0;
+
+				if (!read_raw(stream, padding) || !stream.ignore(padding)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read component {} from snapshot", i);
+
+					return false;
+				}
+
+				std::streamoff position = stream.tellg();
+				std::streamoff column_size = static_cast<std::streamoff>(size) * manager.size;
+
+				// Use column directly from the mapping if its aligned and we're allowed to
+				if (mapping != nullptr && manager.trivially_copyable && position >= 0
+					&& position % SNAPSHOT_ALIGNMENT == 0
+					&& position + column_size <= static_cast<std::streamoff>(mapping->size()))
+				{
+					components.use_external_data(mapping->data() + position, size);
+					stream.seekg(column_size, std::ios_base::cur);
+				}
+				else if (!components.deserialize(stream, size)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read component {} from snapshot", i);
+
+					return false;
+				}
+			}
+
+			archetype.size = size;
+
+			return true;
+		}
+
+		bool registry_t::m_load(std::istream& stream, std::unique_ptr<mapped_file_t> mapping)
+		{
+			uint32_t magic = 0, version = 0;
+
+			if (!read_raw(stream, magic) || magic != SNAPSHOT_MAGIC) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Stream did not contain a registry snapshot");
+
+				return false;
+			}
+
+			if (!read_raw(stream, version) || version != SNAPSHOT_VERSION) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Unsupported snapshot version {}", version);
+
+				return false;
+			}
+
+			uint32_t max_components = 0, entity_id_bits = 0;
+
+			if (!read_raw(stream, max_components) || !read_raw(stream, entity_id_bits)
+				|| max_components != MAX_COMPONENTS || entity_id_bits != ENTITY_ID_BITS)
+			{
+				VIVIUM_ECS_ERROR(severity::ERROR, "Snapshot was saved with {} components and {} entity id bits, but registry has {} and {}",
+					max_components, entity_id_bits, MAX_COMPONENTS, ENTITY_ID_BITS);
+
+				return false;
+			}
+
+			uint32_t component_count = 0;
+
+			if (!read_raw(stream, component_count) || component_count > m_component_gen.new_counter) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Snapshot has {} components, but only {} are registered",
+					component_count, m_component_gen.new_counter);
+
+				return false;
+			}
+
+			for (uint32_t i = 0; i < component_count; i++) {
+				uint32_t component_size = 0;
+
+				if (!read_raw(stream, component_size) || component_size != m_component_managers[i].size) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Component {} has size {} in snapshot, but {} in registry",
+						i, component_size, m_component_managers[i].size);
+
+					return false;
+				}
+			}
+
+			// Declared first so it's destroyed last, after the old archetypes that may point into it
+			std::unique_ptr<mapped_file_t> old_mapping;
+
+			// Parse into temporaries, and only swap them in once the whole snapshot was read
+			std::unordered_map<signature_t, archetype_t> archetypes;
+			std::unordered_map<signature_t, prefab_archetype_t> prefabs;
+			sparse_pools_t sparse_pools;
+			decltype(m_entity_gen) entity_gen;
+			decltype(m_entity_sparse) entity_sparse;
+
+			if (!entity_gen.deserialize(stream)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read entity generator from snapshot");
+
+				return false;
+			}
+
+			uint32_t archetype_count = 0;
+
+			if (!read_raw(stream, archetype_count)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read archetypes from snapshot");
+
+				return false;
+			}
+
+			// Indexed by the archetype index each entity was saved with
+			std::vector<archetype_t*> archetype_list;
+			archetype_list.reserve(archetype_count);
+
+			for (uint32_t archetype_index = 0; archetype_index < archetype_count; archetype_index++) {
+				signature_t signature;
+				uint32_t size = 0;
+
+				if (!signature.deserialize(stream) || !read_raw(stream, size) || archetypes.contains(signature)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read archetype {} from snapshot", archetype_index);
+
+					return false;
+				}
+
+				archetype_t& archetype = archetypes[signature];
+				m_init_archetype(archetype, signature);
+				archetype_list.push_back(&archetype);
+
+				if (!m_load_rows(stream, archetype, size, mapping.get())) return false;
+			}
+
+			uint32_t prefab_archetype_count = 0;
+
+			if (!read_raw(stream, prefab_archetype_count)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read prefab archetypes from snapshot");
+
+				return false;
+			}
+
+			for (uint32_t prefab_index = 0; prefab_index < prefab_archetype_count; prefab_index++) {
+				signature_t signature;
+				uint32_t size = 0;
+
+				if (!signature.deserialize(stream) || !read_raw(stream, size) || prefabs.contains(signature)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read prefab archetype {} from snapshot", prefab_index);
+
+					return false;
+				}
+
+				prefab_archetype_t& prefab = prefabs[signature];
+				m_init_archetype(prefab.storage, signature);
+				archetype_list.push_back(&prefab.storage);
+
+				if (!m_load_rows(stream, prefab.storage, size, mapping.get())) return false;
+			}
+
+			uint32_t sparse_count = 0;
+
+			if (!read_raw(stream, sparse_count)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read sparse components from snapshot");
+
+				return false;
+			}
+
+			for (uint32_t sparse_index = 0; sparse_index < sparse_count; sparse_index++) {
+				uint32_t component_id = COMPONENT_NULL_ID, size = 0;
+
+				if (!read_raw(stream, component_id) || !read_raw(stream, size) || component_id >= MAX_COMPONENTS
+					|| m_sparse_pools[component_id] == nullptr || sparse_pools[component_id] != nullptr)
+				{
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read sparse component {} from snapshot", component_id);
+
+					return false;
+				}
+
+				sparse_pools[component_id] = std::make_unique<sparse_pool_t>(m_component_managers[component_id]);
+				sparse_pool_t& pool = *sparse_pools[component_id];
+
+				pool.entities.resize(size);
+
+				if (!stream.read(reinterpret_cast<char*>(pool.entities.data()), size * sizeof(entity_value_t))
+					|| !pool.components.deserialize(stream, size))
+				{
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read sparse component {} from snapshot", component_id);
+
+					return false;
+				}
+
+				pool.rebuild_indices();
+			}
+
+			uint32_t entity_count = 0;
+
+			if (!read_raw(stream, entity_count)) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read entities from snapshot");
+
+				return false;
+			}
+
+			entity_sparse.reserve(entity_count);
+
+			for (uint32_t i = 0; i < entity_count; i++) {
+				entity_t entity;
+				uint32_t archetype_index = INVALID_INDEX;
+
+				if (!read_raw(stream, entity.value) || !read_raw(stream, archetype_index) || !read_raw(stream, entity.index)) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Failed to read entities from snapshot");
+
+					return false;
+				}
+
+				if (archetype_index != INVALID_INDEX) {
+					if (archetype_index >= archetype_list.size() || entity.index >= archetype_list[archetype_index]->size) {
+						VIVIUM_ECS_ERROR(severity::ERROR, "Entity {} refers to invalid row {} of archetype {}",
+							entity.value, entity.index, archetype_index);
+
+						return false;
+					}
+
+					entity.archetype = archetype_list[archetype_index];
+				}
+
+				entity_sparse.push(entity);
+			}
+
+			// Whole snapshot was read, swap it in, old contents are destroyed with the temporaries
+			std::swap(m_archetypes, archetypes);
+			std::swap(m_prefabs, prefabs);
+			std::swap(m_entity_gen, entity_gen);
+			std::swap(m_entity_sparse, entity_sparse);
+
+			for (component_id_t i : m_sparse_ids) {
+				if (sparse_pools[i] == nullptr)
+					sparse_pools[i] = std::make_unique<sparse_pool_t>(m_component_managers[i]);
+
+				std::swap(m_sparse_pools[i], sparse_pools[i]);
+			}
+
+			old_mapping = std::exchange(m_mapping, std::move(mapping));
+
+			// Relations aren't saved, and would refer to entities of the old contents
+			for (relation_storage_t& relation : m_relations) {
+				relation.clear();
+			}
+
+			return true;
 		}
 	}
 }
@@ -5,14 +5,24 @@
 #include "signature.h"
 #include "entity.h"
 #include "sparse_set.h"
+#include "mapped_file.h"
+#include "profiling.h"
+#include "resource.h"
+#include "relationship.h"
+#include "memory_report.h"
 
 #include "archetype.h"
 
+#include <functional>
 #include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace Vivium {
 	namespace ECS {
 		struct archetype_t;
+		struct rollback_buffer_t;
 		
 		struct registry_t {
 		private:
@@ -20,18 +30,84 @@ namespace Vivium {
 
 			static id_generator<registry_id_t, MAX_REGISTRIES, REGISTRY_NULL_ID> m_registry_gen;
 
+			// Hidden archetype storing prefab rows, with instance archetype resolved once
+			struct prefab_archetype_t {
+				archetype_t storage;
+				archetype_t* target = nullptr;
+			};
+
+			// Snapshot mapping that archetype columns may point into, must outlive archetypes
+			std::unique_ptr<mapped_file_t> m_mapping;
+
 			std::unordered_map<signature_t, archetype_t> m_archetypes;
+			// Iterated in place of archetypes that don't exist, so those queries are empty
+			static archetype_t m_empty_archetype;
+			// Kept separate from queryable archetypes, so prefabs are never iterated
+			std::unordered_map<signature_t, prefab_archetype_t> m_prefabs;
 			id_generator<component_id_t, MAX_COMPONENTS, COMPONENT_NULL_ID> m_component_gen;
+			// Type-erased managers for each registered component, indexed by component id
+			std::array<component_manager_t, MAX_COMPONENTS> m_component_managers;
+			std::array<component_registration_t, MAX_COMPONENTS> m_component_registrations;
+			// Registered components that are tags, so have no columns
+			signature_t m_tags;
+			// Registered components stored in pools instead of archetypes
+			signature_t m_sparse;
+			std::vector<component_id_t> m_sparse_ids;
+			sparse_pools_t m_sparse_pools;
 
 			id_generator<entity_value_t, MAX_ENTITIES, ENTITY_NULL_ID> m_entity_gen;
 
 			sparse_set_t<entity_t, entity_value_t, decltype(m_entity_id_getter),
 				m_entity_id_getter, MAX_ENTITIES, ENTITY_SPARSE_PAGE_SIZE, ENTITY_NULL> m_entity_sparse;
 
+			// Resources indexed by resource_index, grown as new resource types are added
+			std::vector<resource_slot_t> m_resources;
+			// Relation pairs indexed by relation_index, grown as new relation types are added
+			std::vector<relation_storage_t> m_relations;
+
+			// Null if no pair of relation R was ever added
+			template <typename R>
+			const relation_storage_t* m_get_relation_storage() const;
+
+			// Order rows of archetypes holding children by depth in the hierarchy
+			void m_sort_hierarchy(const relation_storage_t& relation);
+
+			// Remove entity from relations and free its id, once it has no components left
+			void m_release_entity(entity_value_t entity);
+
+			bool m_is_prefab(const entity_t& entity) const;
+
+			// Our id for component_id of source, COMPONENT_NULL_ID if not registered here
+			component_id_t m_map_component(const registry_t& source, component_id_t component_id) const;
+			// Translate signature of source to our ids, returns false if any component
+			// isn't registered here
+			bool m_map_signature(const registry_t& source, const signature_t& signature, signature_t& mapped) const;
+
+			// Stably reorder rows of archetype by less on row indices, returns false if
+			// rows were already in order
+			template <typename Less>
+			bool m_sort_rows(archetype_t& archetype, std::vector<uint32_t>& order, Less less);
+
 			registry_id_t m_id;
 
 			archetype_t* m_get_archetype(signature_t signature);
 
+			// Update row of an entity that was moved by a swap remove, ignores ENTITY_NULL
+			void m_set_entity_index(entity_value_t entity, uint32_t index);
+
+			// Create archetype from signature alone, using registered component managers
+			archetype_t* m_create_archetype(signature_t signature);
+
+			prefab_archetype_t& m_create_prefab_archetype(signature_t signature);
+			// Set signature and empty columns of a fresh archetype, shared by both of the above
+			void m_init_archetype(archetype_t& archetype, signature_t signature) const;
+
+			bool m_save_archetype(std::ostream& stream, const archetype_t& archetype) const;
+			bool m_load_rows(std::istream& stream, archetype_t& archetype, uint32_t size, const mapped_file_t* mapping) const;
+			// Load snapshot, with columns pointing into mapping where possible
+			// Parsed into temporaries and swapped in on success, so a failed load leaves the registry untouched
+			bool m_load(std::istream& stream, std::unique_ptr<mapped_file_t> mapping);
+
 			template <typename... Ts>
 			archetype_t* m_extend_archetype(const archetype_t& old_archetype);
 
@@ -44,10 +120,21 @@ namespace Vivium {
 			template <typename... Ts>
 			archetype_t* m_get_or_create_archetype();
 
+			// Move rows of source to the archetype with T added, as one transition
+			template <typename... Ts, typename... Args>
+			void m_push_components(entity_value_t entity_id, Args&&... components);
+			// Push the arguments at archetype_positions_v<Ts...>, skipping sparse components
+			template <typename... Ts, typename tuple_t, size_t... indices>
+			void m_push_archetype_components(entity_value_t entity_id, tuple_t&& arguments, std::index_sequence<indices...>);
+
+			template <typename T>
+			void m_add_component_to_rows(archetype_t& source, const uint32_t* rows, uint32_t count, const T& component);
+
 		public:
 			friend archetype_t;
+			friend rollback_buffer_t;
 
-			registry_t();
+			explicit registry_t(limits_tag_t = {});
 			~registry_t();
 
 			[[nodiscard]] entity_value_t get_entity();
@@ -56,36 +143,179 @@ namespace Vivium {
 			// Clear entity of all components
 			void clear_entity(entity_value_t entity);
 
+			// Disabled entities keep their components and row, but aren't iterated. Only
+			// entities in an archetype can be disabled, and they stay disabled when moved
+			void set_enabled(entity_value_t entity, bool enabled);
+			bool is_enabled(entity_value_t entity) const;
+
 			template <typename T>
 			void push_component(entity_value_t entity_id, const T& component);
+			template <typename T> requires (!std::is_lvalue_reference_v<T>)
+			void push_component(entity_value_t entity_id, T&& component);
 			template <typename... Ts>
 			void push_components(entity_value_t entity_id, const Ts&... components);
+			template <typename... Ts> requires (!std::is_lvalue_reference_v<Ts> && ...)
+			void push_components(entity_value_t entity_id, Ts&&... components);
+
+			// Construct T from args directly in the entity's new column, replacing
+			// the component if the entity already has one
+			template <typename T, typename... Args>
+			void emplace_component(entity_value_t entity_id, Args&&... args);
 
 			template <typename T>
 			void remove_component(entity_value_t entity_id);
 
+			// Add a copy of component to many entities, entities sharing an archetype are
+			// moved together. Entities that already have the component have it replaced
+			template <typename T>
+			void add_component_to(const entity_value_t* entities, uint32_t count, const T& component);
+			template <typename T>
+			void add_component_to(const std::vector<entity_value_t>& entities, const T& component);
+
+			// Add a copy of component to every entity with exactly the components Ts
+			template <typename... Ts, typename T>
+			void add_component_to_query(const T& component);
+
+			// Create an entity whose components are only used as a template for instances,
+			// it is never iterated, and components can be modified but not added or removed.
+			// Sparse components can't be part of a prefab
+			template <typename... Ts>
+			[[nodiscard]] entity_value_t create_prefab(const Ts&... components);
+
+			// Create count entities with copies of the prefab's components
+			std::vector<entity_value_t> instantiate(entity_value_t prefab, uint32_t count);
+
 			template <typename T>
 			T& get_component(entity_value_t entity_id);
 
 			template <typename T>
 			const T& get_component(entity_value_t entity_id) const;
 
-			// TODO: multi-push
-			// TODO: emplace?
+			// Relations are typed links from a source entity to target entities, e.g.
+			// add_relation<child_of_t>(child, parent). Both directions are indexed, and
+			// pairs are removed when either entity is freed. Not written to snapshots
+			template <typename R>
+			void add_relation(entity_value_t source, entity_value_t target);
+			template <typename R>
+			void remove_relation(entity_value_t source, entity_value_t target);
+			template <typename R>
+			bool has_relation(entity_value_t source, entity_value_t target) const;
+
+			// Entities source has relation R to, e.g. the parent of a child
+			template <typename R>
+			const std::vector<entity_value_t>& targets_of(entity_value_t source) const;
+			// Entities that have relation R to target, e.g. all children of a parent
+			template <typename R>
+			const std::vector<entity_value_t>& sources_of(entity_value_t target) const;
+
+			// Hierarchy using relation R from child to parent, each child has at most one parent
+			template <typename R>
+			void set_parent(entity_value_t child, entity_value_t parent);
+			// Returns ENTITY_NULL if child has no parent
+			template <typename R>
+			entity_value_t parent_of(entity_value_t child) const;
+
+			// Reorder archetype rows by depth in hierarchy R, so iterating an archetype visits
+			// each parent before its children, when both are in the same archetype. Archetypes
+			// that are already in order, or hold no children, are left untouched
+			template <typename R>
+			void sort_hierarchy();
+
+			// Stably reorder rows of every archetype containing T so compare(a, b) holds for
+			// each earlier a and later b. Nearly sorted archetypes are re-sorted in linear
+			// time, and archetypes already in order are left untouched
+			template <typename T, typename Compare = std::less<T>>
+			void sort(Compare compare = Compare());
+
+			// Registry-wide data outside of any archetype, at most one instance per type.
+			// Copied by clone, but not written to snapshots
+
+			// Construct resource T from args, replacing any existing one
+			template <typename T, typename... Args>
+			T& emplace_resource(Args&&... args);
+
+			// Resource must exist
+			template <typename T>
+			T& resource();
+			template <typename T>
+			const T& resource() const;
+
+			// Returns nullptr if resource doesn't exist
+			template <typename T>
+			T* try_resource();
+			template <typename T>
+			const T* try_resource() const;
+
+			template <typename T>
+			bool has_resource() const;
+
+			template <typename T>
+			void remove_resource();
 
+			// Iterate entities with exactly the archetype components in Ts, sparse components
+			// in Ts further filter to entities that have them
 			template <typename... Ts>
 			archetype_t::iterator<Ts...> begin();
 
 			template <typename... Ts>
 			archetype_t::iterator<Ts...> end();
 
+			// Move every entity of source into this registry, along with relations between
+			// them. Archetypes are matched by component type, so ids may differ between the
+			// registries, and each column is moved as a whole. Prefabs and resources stay in
+			// source. Returns the new value of each entity indexed by its value in source,
+			// ENTITY_NULL for values not moved, or nothing if a component of source isn't
+			// registered here
+			std::vector<entity_value_t> merge_from(registry_t& source);
+			// Move entity and its components to destination, returns its value there, or
+			// ENTITY_NULL if a component isn't registered in destination. Relations of the
+			// entity are dropped, since the other side stays behind
+			entity_value_t transfer(entity_value_t entity, registry_t& destination);
+
+			// Bytes used and reserved by archetypes, columns, pools and lookups. Reads only
+			// sizes and capacities, so is cheap enough to sample while running
+			[[nodiscard]] memory_report_t memory_report() const;
+			// Refill report, reusing its storage
+			void memory_report(memory_report_t& report) const;
+
+			// Delete archetypes with no entities and release capacity held beyond what's in
+			// use, returns the bytes reclaimed. Invalidates iterators and component references,
+			// so call between frames rather than while iterating
+			size_t compact();
+
+			// Create an independent copy of this registry, with the same entities and
+			// components registered under the same ids
+			[[nodiscard]] std::unique_ptr<registry_t> clone() const;
+
+			// Write all archetypes, entities and id generator state to a binary stream
+			bool save(std::ostream& stream) const;
+			// Replace contents of registry with a snapshot written by save, components
+			// must be registered in the same order as the registry that was saved
+			bool load(std::istream& stream);
+			// Load a snapshot file written by save without copying, trivially copyable
+			// columns point directly into a copy-on-write mapping of the file
+			bool load_mapped(const char* path);
+
 			template <typename T>
 			void register_component() {
 				// Ensure component not already registered
 				if (component_registry<T>::get_id(m_id) != COMPONENT_NULL_ID)
 					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to re-register component {}", typeid(T).name());
 				else {
-					component_registry<T>::register_component(m_id, m_component_gen.get());
+					component_id_t component_id = m_component_gen.get();
+
+					component_registry<T>::register_component(m_id, component_id);
+					m_component_managers[component_id].setup<T>();
+					m_component_registrations[component_id].setup<T>();
+
+					if constexpr (is_sparse_v<T>) {
+						m_sparse.enabled.set(component_id, true);
+						m_sparse_ids.push_back(component_id);
+						m_sparse_pools[component_id] = std::make_unique<sparse_pool_t>(m_component_managers[component_id]);
+					}
+					else if constexpr (is_tag_v<T>) {
+						m_tags.enabled.set(component_id, true);
+					}
 				}
 			}
 		};
@@ -5,18 +5,23 @@
 
 #include "archetype_iterator.inl"
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <numeric>
+
 namespace Vivium {
 	namespace ECS {
 		template <typename... Ts>
 		archetype_t* registry_t::m_extend_archetype(const archetype_t& old_archetype) {
+			VIVIUM_ECS_PROFILE_SCOPE(ARCHETYPE_CREATIONS, "extend_archetype");
+
 			archetype_t new_archetype;
 
-			for (uint32_t i = 0; i < MAX_COMPONENTS; i++) {
-				if (old_archetype.signature.enabled.test(i)) {
-					new_archetype.arrays[i].components = component_array_t(
-						old_archetype.arrays[i].components.get_manager()
-					);
-				}
+			for (component_id_t i : old_archetype.component_ids) {
+				new_archetype.arrays[i].components = component_array_t(
+					old_archetype.arrays[i].components.get_manager()
+				);
 			}
 
 			signature_t new_signature = old_archetype.signature;
@@ -26,10 +31,11 @@ namespace Vivium {
 
 				new_signature.enabled.set(component_id, true);
 
-				new_archetype.arrays[component_id].components.setup<Ts>();
+				if constexpr (!is_tag_v<Ts>)
+					new_archetype.arrays[component_id].components.setup<Ts>();
 				}(), ...);
 
-			new_archetype.signature = new_signature;
+			new_archetype.m_set_signature(new_signature, m_tags);
 
 			// Add archetype to our map
 			auto cond_pair = m_archetypes.insert({ new_signature, std::move(new_archetype) });
@@ -41,14 +47,14 @@ namespace Vivium {
 		template<typename ...Ts>
 		archetype_t* registry_t::m_shrink_archetype(const archetype_t& old_archetype)
 		{
+			VIVIUM_ECS_PROFILE_SCOPE(ARCHETYPE_CREATIONS, "shrink_archetype");
+
 			archetype_t new_archetype;
 
-			for (uint32_t i = 0; i < MAX_COMPONENTS; i++) {
-				if (old_archetype.signature.enabled.test(i)) {
-					new_archetype.arrays[i].components = component_array_t(
-						old_archetype.arrays[i].components.get_manager()
-					);
-				}
+			for (component_id_t i : old_archetype.component_ids) {
+				new_archetype.arrays[i].components = component_array_t(
+					old_archetype.arrays[i].components.get_manager()
+				);
 			}
 
 			signature_t new_signature = old_archetype.signature;
@@ -61,7 +67,7 @@ namespace Vivium {
 				new_archetype.arrays[component_id].components.clear_setup();
 			}(), ...);
 
-			new_archetype.signature = new_signature;
+			new_archetype.m_set_signature(new_signature, m_tags);
 
 			// It's an empty archetype
 			if (new_archetype.signature.enabled.count() == 0) {
@@ -104,6 +110,8 @@ namespace Vivium {
 				return nullptr;
 			}
 
+			VIVIUM_ECS_PROFILE_SCOPE(ARCHETYPE_CREATIONS, "create_archetype");
+
 			// Create new archetype with that setup
 			auto cond_pair = m_archetypes.insert({ signature, archetype_t() });
 			archetype_t& new_archetype = cond_pair.first->second;
@@ -113,43 +121,147 @@ namespace Vivium {
 			return &new_archetype;
 		}
 
+		template <typename... Ts>
+		entity_value_t registry_t::create_prefab(const Ts&... components) {
+			static_assert(!(is_sparse_v<Ts> || ...), "Prefabs can't have sparse components");
+
+			signature_t signature;
+			signature.setup<Ts...>(m_id);
+
+			auto it = m_prefabs.find(signature);
+
+			prefab_archetype_t& prefab = it != m_prefabs.end() ? it->second : m_create_prefab_archetype(signature);
+
+			entity_t entity;
+			entity.value = m_entity_gen.get();
+
+			prefab.storage.push_entity<Ts...>(entity, m_id, components...);
+
+			m_entity_sparse.push(entity);
+
+			return entity.value;
+		}
+
 		template <typename T>
 		void registry_t::push_component(entity_value_t entity_id, const T& component) {
+			emplace_component<T>(entity_id, component);
+		}
+
+		template <typename T> requires (!std::is_lvalue_reference_v<T>)
+		void registry_t::push_component(entity_value_t entity_id, T&& component) {
+			emplace_component<T>(entity_id, std::move(component));
+		}
+
+		template <typename T, typename... Args>
+		void registry_t::emplace_component(entity_value_t entity_id, Args&&... args) {
 			entity_t& entity = m_entity_sparse.at(entity_id);
 
+			// Prefab components can be replaced, but not added
+			if (m_is_prefab(entity) && (is_sparse_v<T> || !entity.archetype->signature.enabled.test(component_registry<T>::get_id(m_id)))) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to add component {} to prefab {}", typeid(T).name(), entity_id);
+
+				return;
+			}
+
+			// Sparse components never change the entity's archetype
+			if constexpr (is_sparse_v<T>) {
+				component_id_t component_id = component_registry<T>::get_id(m_id);
+
+				m_sparse_pools[component_id]->emplace<T>(entity_id, std::forward<Args>(args)...);
+
+				return;
+			}
+
 			// Get current archetype of this entity
 			archetype_t* current_archetype = entity.archetype;
 
 			if (current_archetype != nullptr) {
-				current_archetype->push_component<T>(entity, *this, component);
+				current_archetype->emplace_component<T>(entity, *this, std::forward<Args>(args)...);
 			}
 			else {
 				// Get/create new archetype
 				current_archetype = m_get_or_create_archetype<T>();
-				current_archetype->push_entity<T>(entity, m_id, component);
+				current_archetype->emplace_entity<T>(entity, m_id, std::forward<Args>(args)...);
 			}
 		}
 
-		template<typename ...Ts>
-		void registry_t::push_components(entity_value_t entity_id, const Ts&... components)
+		template <typename... Ts>
+		void registry_t::push_components(entity_value_t entity_id, const Ts&... components) {
+			m_push_components<Ts...>(entity_id, components...);
+		}
+
+		template <typename... Ts> requires (!std::is_lvalue_reference_v<Ts> && ...)
+		void registry_t::push_components(entity_value_t entity_id, Ts&&... components) {
+			m_push_components<Ts...>(entity_id, std::move(components)...);
+		}
+
+		template <typename... Ts, typename... Args>
+		void registry_t::m_push_components(entity_value_t entity_id, Args&&... components)
 		{
+			if (m_is_prefab(m_entity_sparse.at(entity_id))) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to add components to prefab {}", entity_id);
+
+				return;
+			}
+
+			// Sparse components go to their pools, and the rest are pushed together so the
+			// entity still changes archetype once
+			if constexpr ((is_sparse_v<Ts> || ...)) {
+				m_push_archetype_components<Ts...>(
+					entity_id,
+					std::forward_as_tuple(std::forward<Args>(components)...),
+					std::make_index_sequence<archetype_positions_v<Ts...>.size()>{}
+				);
+
+				([&]() {
+					if constexpr (is_sparse_v<Ts>)
+						emplace_component<Ts>(entity_id, std::forward<Args>(components));
+				}(), ...);
+
+				return;
+			}
+
 			entity_t& entity = m_entity_sparse.at(entity_id);
 
 			// Get current archetype of this entity
 			archetype_t* current_archetype = entity.archetype;
 
 			if (current_archetype != nullptr) {
-				current_archetype->push_components<Ts...>(entity, *this, components...);
+				current_archetype->push_components<Ts...>(entity, *this, std::forward<Args>(components)...);
 			}
 			else {
 				current_archetype = m_get_or_create_archetype<Ts...>();
-				current_archetype->push_entity<Ts...>(entity, m_id, components...);
+				current_archetype->push_entity<Ts...>(entity, m_id, std::forward<Args>(components)...);
+			}
+		}
+
+		template <typename... Ts, typename tuple_t, size_t... indices>
+		void registry_t::m_push_archetype_components(entity_value_t entity_id, tuple_t&& arguments, std::index_sequence<indices...>)
+		{
+			if constexpr (sizeof...(indices) > 0) {
+				m_push_components<std::tuple_element_t<archetype_positions_v<Ts...>[indices], std::tuple<Ts...>>...>(
+					entity_id,
+					std::get<archetype_positions_v<Ts...>[indices]>(std::move(arguments))...
+				);
 			}
 		}
 
 		template<typename T>
 		void registry_t::remove_component(entity_value_t entity_id)
 		{
+			if (m_is_prefab(m_entity_sparse.at(entity_id))) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to remove component {} from prefab {}", typeid(T).name(), entity_id);
+
+				return;
+			}
+
+			if constexpr (is_sparse_v<T>) {
+				if (!m_sparse_pools[component_registry<T>::get_id(m_id)]->erase(entity_id))
+					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to remove component {} that entity didn't have", typeid(T).name());
+
+				return;
+			}
+
 			entity_t& entity = m_entity_sparse.at(entity_id);
 
 			// Get current archetype of this entity
@@ -162,60 +274,416 @@ namespace Vivium {
 				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to remove component from entity with no components");
 		}
 
+		template <typename T>
+		void registry_t::m_add_component_to_rows(archetype_t& source, const uint32_t* rows, uint32_t count, const T& component) {
+			component_id_t component_id = component_registry<T>::get_id(m_id);
+
+			archetype_t* destination = source.m_get_add_archetype<T>(*this, component_id);
+
+			source.m_transfer_rows(rows, count, *destination, *this);
+
+			if constexpr (!is_tag_v<T>) {
+				// Copy the first instance into the rest
+				component_array_t& components = destination->arrays[component_id].components;
+
+				components.push_back(component);
+				components.append_clones(components, components.size() - 1, count - 1);
+			}
+		}
+
+		template <typename T>
+		void registry_t::add_component_to(const entity_value_t* entities, uint32_t count, const T& component) {
+			component_id_t component_id = component_registry<T>::get_id(m_id);
+
+			// Nothing moves between archetypes, so each entity is added to the pool
+			if constexpr (is_sparse_v<T>) {
+				for (uint32_t i = 0; i < count; i++) {
+					if (m_is_prefab(m_entity_sparse.at(entities[i]))) {
+						VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to add component {} to prefab {}", typeid(T).name(), entities[i]);
+
+						continue;
+					}
+
+					m_sparse_pools[component_id]->emplace<T>(entities[i], component);
+				}
+
+				return;
+			}
+
+			// Source archetype and row of each entity that needs moving
+			std::vector<std::pair<archetype_t*, uint32_t>> rows;
+			rows.reserve(count);
+
+			for (uint32_t i = 0; i < count; i++) {
+				entity_t& entity = m_entity_sparse.at(entities[i]);
+
+				if (entity.archetype == nullptr)
+					push_component<T>(entities[i], component);
+				else if (entity.archetype->signature.enabled.test(component_id)) {
+					if constexpr (!is_tag_v<T>)
+						entity.archetype->arrays[component_id].components.replace_at(component, entity.index);
+				}
+				else if (m_is_prefab(entity))
+					VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to add component {} to prefab {}", typeid(T).name(), entities[i]);
+				else
+					rows.push_back({ entity.archetype, entity.index });
+			}
+
+			// Group by archetype, with rows ascending
+			std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+				if (a.first != b.first)
+					return std::less<archetype_t*>()(a.first, b.first);
+
+				return a.second < b.second;
+			});
+
+			rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+			std::vector<uint32_t> group;
+
+			for (size_t first = 0; first < rows.size();) {
+				archetype_t* source = rows[first].first;
+
+				group.clear();
+
+				for (; first < rows.size() && rows[first].first == source; first++) {
+					group.push_back(rows[first].second);
+				}
+
+				m_add_component_to_rows<T>(*source, group.data(), static_cast<uint32_t>(group.size()), component);
+			}
+		}
+
+		template <typename T>
+		void registry_t::add_component_to(const std::vector<entity_value_t>& entities, const T& component) {
+			add_component_to<T>(entities.data(), static_cast<uint32_t>(entities.size()), component);
+		}
+
+		template <typename... Ts, typename T>
+		void registry_t::add_component_to_query(const T& component) {
+			// Find archetype, sparse components aren't part of it
+			signature_t signature;
+			signature.setup<Ts...>(m_id);
+			signature.enabled &= ~m_sparse.enabled;
+
+			archetype_t* archetype = m_get_archetype(signature);
+
+			if (archetype == nullptr || archetype->size == 0) return;
+
+			component_id_t component_id = component_registry<T>::get_id(m_id);
+
+			// Rows whose entity also has every sparse component of the query, like begin()
+			std::vector<uint32_t> rows;
+
+			if constexpr ((is_sparse_v<Ts> || ...)) {
+				for (uint32_t row = 0; row < archetype->size; row++) {
+					entity_value_t entity = archetype->entities[row];
+
+					if (((!is_sparse_v<Ts> || m_sparse_pools[component_registry<Ts>::get_id(m_id)]->contains(entity)) && ...))
+						rows.push_back(row);
+				}
+
+				if (rows.empty()) return;
+			}
+			else {
+				rows.resize(archetype->size);
+				std::iota(rows.begin(), rows.end(), 0);
+			}
+
+			uint32_t count = static_cast<uint32_t>(rows.size());
+
+			if constexpr (is_sparse_v<T>) {
+				for (uint32_t row : rows) {
+					emplace_component<T>(archetype->entities[row], component);
+				}
+
+				return;
+			}
+
+			// Query already has the component, so every row is replaced
+			if (signature.enabled.test(component_id)) {
+				if constexpr (!is_tag_v<T>) {
+					for (uint32_t row : rows) {
+						archetype->arrays[component_id].components.replace_at(component, row);
+					}
+				}
+
+				return;
+			}
+
+			// Rows are ascending, and when every row moves columns are moved whole
+			m_add_component_to_rows<T>(*archetype, rows.data(), count, component);
+		}
+
 		template<typename T>
 		T& registry_t::get_component(entity_value_t entity_id)
 		{
+			if constexpr (is_sparse_v<T>)
+				return m_sparse_pools[component_registry<T>::get_id(m_id)]->template at<T>(entity_id);
+
 			const entity_t& entity = m_entity_sparse.at(entity_id);
 
-			if (entity.archetype != nullptr) {
-				return entity.archetype->get_component<T>(entity, m_id);
-			}
+			VIVIUM_ECS_CHECK(entity.archetype != nullptr, severity::FATAL, "Attempted to get component from an entity with no components");
 
-			VIVIUM_ECS_ERROR(severity::FATAL, "Attempted to get component from an entity with no components");
+			return entity.archetype->get_component<T>(entity, m_id);
 		}
 		
 		template<typename T>
 		const T& registry_t::get_component(entity_value_t entity_id) const
 		{
+			if constexpr (is_sparse_v<T>)
+				return m_sparse_pools[component_registry<T>::get_id(m_id)]->template at<T>(entity_id);
+
 			const entity_t& entity = m_entity_sparse.at(entity_id);
 
-			if (entity.archetype != nullptr) {
-				return entity.archetype->get_component<T>(entity, m_id);
+			VIVIUM_ECS_CHECK(entity.archetype != nullptr, severity::FATAL, "Attempted to get component from an entity with no components");
+
+			return entity.archetype->get_component<T>(entity, m_id);
+		}
+
+		template <typename R>
+		const relation_storage_t* registry_t::m_get_relation_storage() const {
+			relation_id_t id = relation_index<R>::get();
+
+			return id < m_relations.size() ? &m_relations[id] : nullptr;
+		}
+
+		template <typename R>
+		void registry_t::add_relation(entity_value_t source, entity_value_t target) {
+			relation_id_t id = relation_index<R>::get();
+
+			if (id >= m_relations.size())
+				m_relations.resize(id + 1);
+
+			if (!m_relations[id].add(source, target))
+				VIVIUM_ECS_ERROR(severity::WARN, "Entity {} already had relation {} to {}", source, typeid(R).name(), target);
+		}
+
+		template <typename R>
+		void registry_t::remove_relation(entity_value_t source, entity_value_t target) {
+			relation_id_t id = relation_index<R>::get();
+
+			if (id >= m_relations.size() || !m_relations[id].remove(source, target))
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to remove relation {} from {} to {} that didn't exist", typeid(R).name(), source, target);
+		}
+
+		template <typename R>
+		bool registry_t::has_relation(entity_value_t source, entity_value_t target) const {
+			const relation_storage_t* storage = m_get_relation_storage<R>();
+
+			return storage != nullptr && storage->contains(source, target);
+		}
+
+		template <typename R>
+		const std::vector<entity_value_t>& registry_t::targets_of(entity_value_t source) const {
+			static const std::vector<entity_value_t> none;
+
+			const relation_storage_t* storage = m_get_relation_storage<R>();
+
+			if (storage == nullptr) return none;
+
+			auto it = storage->targets.find(source);
+
+			return it != storage->targets.end() ? it->second : none;
+		}
+
+		template <typename R>
+		const std::vector<entity_value_t>& registry_t::sources_of(entity_value_t target) const {
+			static const std::vector<entity_value_t> none;
+
+			const relation_storage_t* storage = m_get_relation_storage<R>();
+
+			if (storage == nullptr) return none;
+
+			auto it = storage->sources.find(target);
+
+			return it != storage->sources.end() ? it->second : none;
+		}
+
+		template <typename R>
+		void registry_t::set_parent(entity_value_t child, entity_value_t parent) {
+			entity_value_t old_parent = parent_of<R>(child);
+
+			if (old_parent == parent) return;
+
+			if (old_parent != ENTITY_NULL)
+				remove_relation<R>(child, old_parent);
+
+			add_relation<R>(child, parent);
+		}
+
+		template <typename R>
+		entity_value_t registry_t::parent_of(entity_value_t child) const {
+			const std::vector<entity_value_t>& parents = targets_of<R>(child);
+
+			return parents.empty() ? ENTITY_NULL : parents.front();
+		}
+
+		template <typename R>
+		void registry_t::sort_hierarchy() {
+			const relation_storage_t* storage = m_get_relation_storage<R>();
+
+			if (storage != nullptr)
+				m_sort_hierarchy(*storage);
+		}
+
+		template <typename Less>
+		bool registry_t::m_sort_rows(archetype_t& archetype, std::vector<uint32_t>& order, Less less) {
+			uint32_t size = archetype.size;
+
+			// Row index breaks ties, so the result is stable whichever sort produces it
+			auto before = [&](uint32_t a, uint32_t b) { return less(a, b) || (!less(b, a) && a < b); };
+
+			// Keep a sorted run of rows, setting aside both rows of every descent
+			std::vector<uint32_t> displaced;
+
+			order.clear();
+
+			for (uint32_t row = 0; row < size; row++) {
+				if (!order.empty() && less(row, order.back())) {
+					displaced.push_back(order.back());
+					displaced.push_back(row);
+					order.pop_back();
+				}
+				else {
+					order.push_back(row);
+				}
 			}
 
-			VIVIUM_ECS_ERROR(severity::FATAL, "Attempted to get component from an entity with no components");
+			if (displaced.empty()) return false;
+
+			// Few rows out of place, so merge them back in rather than sorting everything
+			if (displaced.size() <= size / 8) {
+				std::sort(displaced.begin(), displaced.end(), before);
+
+				std::vector<uint32_t> merged;
+				merged.reserve(size);
+
+				std::merge(order.begin(), order.end(), displaced.begin(), displaced.end(), std::back_inserter(merged), before);
+				order.swap(merged);
+			}
+			else {
+				order.resize(size);
+				std::iota(order.begin(), order.end(), 0);
+				std::sort(order.begin(), order.end(), before);
+			}
+
+			archetype.m_reorder_rows(order.data(), *this);
+
+			return true;
+		}
+
+		template <typename T, typename Compare>
+		void registry_t::sort(Compare compare) {
+			static_assert(!is_tag_v<T>, "Tags have no value to sort by");
+			static_assert(!is_sparse_v<T>, "Sparse components aren't stored in archetype rows");
+
+			component_id_t component_id = component_registry<T>::get_id(m_id);
+
+			if (component_id == COMPONENT_NULL_ID) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to sort by unregistered component {}", typeid(T).name());
+
+				return;
+			}
+
+			std::vector<uint32_t> order;
+
+			for (auto& [signature, archetype] : m_archetypes) {
+				if (!signature.enabled.test(component_id)) continue;
+
+				const component_array_t& components = archetype.arrays[component_id].components;
+
+				m_sort_rows(archetype, order, [&](uint32_t a, uint32_t b) {
+					return compare(components.at<T>(a), components.at<T>(b));
+				});
+			}
+		}
+
+		template <typename T, typename... Args>
+		T& registry_t::emplace_resource(Args&&... args) {
+			resource_id_t id = resource_index<T>::get();
+
+			if (id >= m_resources.size())
+				m_resources.resize(id + 1);
+
+			return m_resources[id].emplace<T>(std::forward<Args>(args)...);
+		}
+
+		template <typename T>
+		T& registry_t::resource() {
+			T* value = try_resource<T>();
+
+			VIVIUM_ECS_CHECK(value != nullptr, severity::FATAL, "Attempted to get resource {} that doesn't exist", typeid(T).name());
+
+			return *value;
+		}
+
+		template <typename T>
+		const T& registry_t::resource() const {
+			const T* value = try_resource<T>();
+
+			VIVIUM_ECS_CHECK(value != nullptr, severity::FATAL, "Attempted to get resource {} that doesn't exist", typeid(T).name());
+
+			return *value;
+		}
+
+		template <typename T>
+		T* registry_t::try_resource() {
+			resource_id_t id = resource_index<T>::get();
+
+			return id < m_resources.size() ? static_cast<T*>(m_resources[id].data) : nullptr;
+		}
+
+		template <typename T>
+		const T* registry_t::try_resource() const {
+			resource_id_t id = resource_index<T>::get();
+
+			return id < m_resources.size() ? static_cast<const T*>(m_resources[id].data) : nullptr;
+		}
+
+		template <typename T>
+		bool registry_t::has_resource() const {
+			return try_resource<T>() != nullptr;
+		}
+
+		template <typename T>
+		void registry_t::remove_resource() {
+			resource_id_t id = resource_index<T>::get();
+
+			if (id < m_resources.size())
+				m_resources[id].reset();
 		}
 
 		template <typename... Ts>
 		archetype_t::iterator<Ts...> registry_t::begin() {
-			// Find archetype
+			// Find archetype, sparse components aren't part of it
 			signature_t signature;
 			signature.setup<Ts...>(m_id);
+			signature.enabled &= ~m_sparse.enabled;
 
 			archetype_t* archetype = m_get_archetype(signature);
 
-			if (archetype == nullptr) {
-				VIVIUM_ECS_ERROR(severity::FATAL, "Attempted to iterate types that don't have associated archetype created");
-			}
-			else {
-				return archetype->begin<Ts...>(m_id);
-			}
+			// No entity has exactly these components, or its archetype was compacted away
+			if (archetype == nullptr)
+				archetype = &m_empty_archetype;
+
+			return archetype->begin<Ts...>(m_id, &m_sparse_pools);
 		}
 
 		template <typename... Ts>
 		archetype_t::iterator<Ts...> registry_t::end() {
-			// Find archetype
+			// Find archetype, sparse components aren't part of it
 			signature_t signature;
 			signature.setup<Ts...>(m_id);
+			signature.enabled &= ~m_sparse.enabled;
 
 			archetype_t* archetype = m_get_archetype(signature);
 
-			if (archetype == nullptr) {
-				VIVIUM_ECS_ERROR(severity::FATAL, "Attempted to iterate types that don't have associated archetype created");
-			}
-			else {
-				return archetype->end<Ts...>(m_id);
-			}
+			// No entity has exactly these components, or its archetype was compacted away
+			if (archetype == nullptr)
+				archetype = &m_empty_archetype;
+
+			return archetype->end<Ts...>(m_id, &m_sparse_pools);
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "constants.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+namespace Vivium {
+	namespace ECS {
+		inline std::atomic<relation_id_t> next_relation_id = 0;
+
+		// Dense id per relation type, shared by every registry so it indexes each
+		// registry's relation storage directly
+		template <typename R>
+		struct relation_index {
+			static relation_id_t get() {
+				static const relation_id_t id = next_relation_id.fetch_add(1, std::memory_order_relaxed);
+
+				return id;
+			}
+		};
+
+		// Pairs (source, target) of one relation type, indexed both ways so either
+		// side can be found without scanning every entity
+		struct relation_storage_t {
+		private:
+			static void m_erase_from(std::unordered_map<entity_value_t, std::vector<entity_value_t>>& map, entity_value_t key, entity_value_t value) {
+				auto it = map.find(key);
+
+				if (it == map.end()) return;
+
+				std::vector<entity_value_t>& values = it->second;
+				auto value_it = std::find(values.begin(), values.end(), value);
+
+				if (value_it != values.end()) {
+					*value_it = values.back();
+					values.pop_back();
+				}
+
+				if (values.empty())
+					map.erase(it);
+			}
+
+		public:
+			std::unordered_map<entity_value_t, std::vector<entity_value_t>> targets;
+			std::unordered_map<entity_value_t, std::vector<entity_value_t>> sources;
+
+			bool contains(entity_value_t source, entity_value_t target) const {
+				auto it = targets.find(source);
+
+				return it != targets.end()
+					&& std::find(it->second.begin(), it->second.end(), target) != it->second.end();
+			}
+
+			// Returns false if the pair already existed
+			bool add(entity_value_t source, entity_value_t target) {
+				if (contains(source, target)) return false;
+
+				targets[source].push_back(target);
+				sources[target].push_back(source);
+
+				return true;
+			}
+
+			// Returns false if the pair didn't exist
+			bool remove(entity_value_t source, entity_value_t target) {
+				if (!contains(source, target)) return false;
+
+				m_erase_from(targets, source, target);
+				m_erase_from(sources, target, source);
+
+				return true;
+			}
+
+			// Remove every pair the entity is part of, as source or target
+			void remove_entity(entity_value_t entity) {
+				if (auto it = targets.find(entity); it != targets.end()) {
+					for (entity_value_t target : it->second) {
+						m_erase_from(sources, target, entity);
+					}
+
+					targets.erase(it);
+				}
+
+				if (auto it = sources.find(entity); it != sources.end()) {
+					for (entity_value_t source : it->second) {
+						m_erase_from(targets, source, entity);
+					}
+
+					sources.erase(it);
+				}
+			}
+
+			bool empty() const { return targets.empty(); }
+
+			void clear() {
+				targets.clear();
+				sources.clear();
+			}
+		};
+	}
+}
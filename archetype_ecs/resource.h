@@ -0,0 +1,97 @@
+#pragma once
+
+#include "constants.h"
+#include "error_handler.h"
+
+#include <atomic>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace Vivium {
+	namespace ECS {
+		inline std::atomic<resource_id_t> next_resource_id = 0;
+
+		// Dense id per resource type, shared by every registry so it indexes each
+		// registry's slots directly. Also identifies the resource when tracking access
+		template <typename T>
+		struct resource_index {
+			static resource_id_t get() {
+				static const resource_id_t id = next_resource_id.fetch_add(1, std::memory_order_relaxed);
+
+				return id;
+			}
+		};
+
+		// Owning type-erased storage for one resource
+		struct resource_slot_t {
+			typedef void (*destroy_t)(void* data);
+			typedef void* (*clone_t)(const void* data);
+
+			void* data = nullptr;
+			destroy_t destroy = nullptr;
+			clone_t clone = nullptr;
+
+			resource_slot_t() = default;
+			~resource_slot_t() { reset(); }
+
+			resource_slot_t(const resource_slot_t&) = delete;
+			resource_slot_t& operator=(const resource_slot_t&) = delete;
+
+			resource_slot_t(resource_slot_t&& other) noexcept
+				: data(std::exchange(other.data, nullptr)), destroy(other.destroy), clone(other.clone)
+			{}
+
+			resource_slot_t& operator=(resource_slot_t&& other) noexcept {
+				if (this != &other) {
+					reset();
+
+					data = std::exchange(other.data, nullptr);
+					destroy = other.destroy;
+					clone = other.clone;
+				}
+
+				return *this;
+			}
+
+			template <typename T, typename... Args>
+			T& emplace(Args&&... args) {
+				reset();
+
+				T* value = new T(std::forward<Args>(args)...);
+
+				data = value;
+				destroy = [](void* data) { delete static_cast<T*>(data); };
+				clone = [](const void* data) -> void* {
+					if constexpr (std::is_copy_constructible_v<T>) {
+						return new T(*static_cast<const T*>(data));
+					}
+					else {
+						VIVIUM_ECS_ERROR(severity::ERROR, "No method to clone resource {}", typeid(T).name());
+
+						return nullptr;
+					}
+				};
+
+				return *value;
+			}
+
+			void reset() {
+				if (data != nullptr) {
+					destroy(data);
+					data = nullptr;
+				}
+			}
+
+			void clone_from(const resource_slot_t& other) {
+				reset();
+
+				if (other.data != nullptr) {
+					data = other.clone(other.data);
+					destroy = other.destroy;
+					clone = other.clone;
+				}
+			}
+		};
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace Vivium {
+	namespace ECS {
+		// Bounded lock-free queue, safe for any number of threads to push and pop,
+		// each slot is published through its own sequence number so no locks are needed
+		template <typename T, uint32_t capacity>
+		struct ring_buffer_t {
+			static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0,
+				"Capacity must be a power of two, so positions stay consistent when they wrap");
+
+		private:
+			struct slot_t {
+				// Equal to position when free to write, position + 1 once written
+				std::atomic<uint32_t> sequence;
+				T value;
+			};
+
+			std::array<slot_t, capacity> m_slots;
+
+			// Kept on separate cache lines so producers and consumers don't contend
+			alignas(64) std::atomic<uint32_t> m_head;
+			alignas(64) std::atomic<uint32_t> m_tail;
+
+		public:
+			ring_buffer_t() : m_head(0), m_tail(0) {
+				for (uint32_t i = 0; i < capacity; i++) {
+					m_slots[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			ring_buffer_t(const ring_buffer_t&) = delete;
+			ring_buffer_t& operator=(const ring_buffer_t&) = delete;
+
+			// Returns false if full
+			bool try_push(const T& value) {
+				uint32_t position = m_head.load(std::memory_order_relaxed);
+
+				while (true) {
+					slot_t& slot = m_slots[position % capacity];
+					uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+					int32_t difference = static_cast<int32_t>(sequence - position);
+
+					if (difference == 0) {
+						// Claim slot, on failure position is reloaded
+						if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+							slot.value = value;
+							slot.sequence.store(position + 1, std::memory_order_release);
+
+							return true;
+						}
+					}
+					// Slot still holds a value from a lap ago
+					else if (difference < 0) {
+						return false;
+					}
+					else {
+						position = m_head.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			// Returns false if empty
+			bool try_pop(T& value) {
+				uint32_t position = m_tail.load(std::memory_order_relaxed);
+
+				while (true) {
+					slot_t& slot = m_slots[position % capacity];
+					uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+					int32_t difference = static_cast<int32_t>(sequence - (position + 1));
+
+					if (difference == 0) {
+						if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+							value = std::move(slot.value);
+							// Free slot for the next lap
+							slot.sequence.store(position + capacity, std::memory_order_release);
+
+							return true;
+						}
+					}
+					else if (difference < 0) {
+						return false;
+					}
+					else {
+						position = m_tail.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			// Push, discarding the oldest values until there is room
+			void push_overwrite(const T& value) {
+				T discarded;
+
+				while (!try_push(value)) {
+					try_pop(discarded);
+				}
+			}
+
+			void clear() {
+				T discarded;
+
+				while (try_pop(discarded));
+			}
+
+			// Visit values from oldest to newest without removing them. Not safe alongside
+			// pops from other threads, including those made by push_overwrite
+			template <typename func_t>
+			void for_each(func_t func) const {
+				// Tail first, head is never behind a tail read before it
+				uint32_t tail = m_tail.load(std::memory_order_acquire);
+				uint32_t head = m_head.load(std::memory_order_acquire);
+
+				for (uint32_t position = tail; position != head; position++) {
+					const slot_t& slot = m_slots[position % capacity];
+
+					// Skip slots claimed but not yet written
+					if (slot.sequence.load(std::memory_order_acquire) == position + 1)
+						func(slot.value);
+				}
+			}
+
+			uint32_t size() const {
+				uint32_t tail = m_tail.load(std::memory_order_acquire);
+
+				return m_head.load(std::memory_order_acquire) - tail;
+			}
+
+			bool empty() const {
+				return size() == 0;
+			}
+		};
+	}
+}
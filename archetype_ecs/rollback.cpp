@@ -0,0 +1,406 @@
+#include "rollback.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace Vivium {
+	namespace ECS {
+		bool rollback_buffer_t::m_record(std::vector<uint8_t>& shadow, const uint8_t* current, uint32_t current_size, buffer_delta_t& delta)
+		{
+			uint32_t old_size = static_cast<uint32_t>(shadow.size());
+			uint32_t max_size = std::max(old_size, current_size);
+
+			delta.old_size = old_size;
+
+			// Keep old bytes around while we overwrite shadow, only grows if current is bigger
+			if (current_size > old_size)
+				shadow.resize(current_size);
+
+			for (uint32_t offset = 0; offset < max_size; offset += ROLLBACK_CHUNK_SIZE) {
+				uint32_t old_end = std::min(offset + ROLLBACK_CHUNK_SIZE, old_size);
+				uint32_t new_end = std::min(offset + ROLLBACK_CHUNK_SIZE, current_size);
+
+				if (old_end == new_end && std::memcmp(&shadow[offset], &current[offset], new_end - offset) == 0)
+					continue;
+
+				delta.chunk_offsets.push_back(offset);
+
+				if (old_end > offset)
+					delta.old_bytes.insert(delta.old_bytes.end(), shadow.begin() + offset, shadow.begin() + old_end);
+
+				if (new_end > offset)
+					std::memcpy(&shadow[offset], &current[offset], new_end - offset);
+			}
+
+			shadow.resize(current_size);
+
+			return !delta.chunk_offsets.empty();
+		}
+
+		void rollback_buffer_t::m_revert(std::vector<uint8_t>& shadow, const buffer_delta_t& delta)
+		{
+			shadow.resize(delta.old_size);
+
+			uint32_t read = 0;
+
+			for (uint32_t offset : delta.chunk_offsets) {
+				// Chunk didn't exist before, so truncating was enough
+				if (offset >= delta.old_size) continue;
+
+				uint32_t length = std::min(ROLLBACK_CHUNK_SIZE, delta.old_size - offset);
+
+				std::memcpy(&shadow[offset], &delta.old_bytes[read], length);
+
+				read += length;
+			}
+		}
+
+		void rollback_buffer_t::m_copy_changed(const std::vector<uint8_t>& shadow, uint8_t* destination)
+		{
+			uint32_t size = static_cast<uint32_t>(shadow.size());
+
+			// Only write chunks that differ, so untouched pages stay clean
+			for (uint32_t offset = 0; offset < size; offset += ROLLBACK_CHUNK_SIZE) {
+				uint32_t length = std::min(ROLLBACK_CHUNK_SIZE, size - offset);
+
+				if (std::memcmp(&shadow[offset], &destination[offset], length) != 0)
+					std::memcpy(&destination[offset], &shadow[offset], length);
+			}
+		}
+
+		void rollback_buffer_t::m_record_archetype(const archetype_t& archetype, archetype_shadow_t& shadow, std::vector<archetype_delta_t>& deltas)
+		{
+			if (shadow.columns.empty())
+				shadow.columns.resize(archetype.component_ids.size() + 2);
+
+			archetype_delta_t archetype_delta;
+			archetype_delta.signature = archetype.signature;
+			archetype_delta.old_size = shadow.size;
+
+			uint32_t column = 0;
+
+			for (component_id_t i : archetype.component_ids) {
+				const component_array_t& components = archetype.arrays[i].components;
+
+				buffer_delta_t column_delta;
+
+				bool changed = m_record(
+					shadow.columns[column],
+					components.data(),
+					components.size() * components.get_manager().size,
+					column_delta
+				);
+
+				if (changed)
+					archetype_delta.columns.push_back({ column, std::move(column_delta) });
+
+				++column;
+			}
+
+			buffer_delta_t entities_delta;
+
+			bool entities_changed = m_record(
+				shadow.columns[column],
+				reinterpret_cast<const uint8_t*>(archetype.entities.data()),
+				static_cast<uint32_t>(archetype.entities.size() * sizeof(entity_value_t)),
+				entities_delta
+			);
+
+			if (entities_changed)
+				archetype_delta.columns.push_back({ column, std::move(entities_delta) });
+
+			++column;
+
+			buffer_delta_t enabled_delta;
+
+			bool enabled_changed = m_record(
+				shadow.columns[column],
+				reinterpret_cast<const uint8_t*>(archetype.enabled_rows.data()),
+				static_cast<uint32_t>(archetype.enabled_rows.size() * sizeof(uint64_t)),
+				enabled_delta
+			);
+
+			if (enabled_changed)
+				archetype_delta.columns.push_back({ column, std::move(enabled_delta) });
+
+			shadow.size = archetype.size;
+
+			if (!archetype_delta.columns.empty() || archetype_delta.old_size != archetype.size)
+				deltas.push_back(std::move(archetype_delta));
+		}
+
+		void rollback_buffer_t::m_revert_archetypes(std::unordered_map<signature_t, archetype_shadow_t>& shadows, const std::vector<archetype_delta_t>& deltas)
+		{
+			for (const archetype_delta_t& archetype_delta : deltas) {
+				archetype_shadow_t& shadow = shadows[archetype_delta.signature];
+
+				shadow.size = archetype_delta.old_size;
+
+				for (const auto& [column, column_delta] : archetype_delta.columns) {
+					m_revert(shadow.columns[column], column_delta);
+				}
+			}
+		}
+
+		void rollback_buffer_t::m_restore_archetype(archetype_t& archetype, const archetype_shadow_t* shadow)
+		{
+			uint32_t column = 0;
+
+			for (component_id_t i : archetype.component_ids) {
+				component_array_t& components = archetype.arrays[i].components;
+
+				// Archetype was created after the checkpoint
+				if (shadow == nullptr) {
+					components.resize_uninitialised(0);
+
+					continue;
+				}
+
+				const std::vector<uint8_t>& column_shadow = shadow->columns[column++];
+
+				components.resize_uninitialised(
+					static_cast<uint32_t>(column_shadow.size()) / components.get_manager().size
+				);
+
+				m_copy_changed(column_shadow, components.data());
+			}
+
+			if (shadow == nullptr) {
+				archetype.m_resize_rows(0);
+				archetype.size = 0;
+
+				return;
+			}
+
+			const std::vector<uint8_t>& entities_shadow = shadow->columns[column];
+			const std::vector<uint8_t>& enabled_shadow = shadow->columns[column + 1];
+
+			archetype.m_resize_rows(static_cast<uint32_t>(entities_shadow.size() / sizeof(entity_value_t)));
+
+			if (!entities_shadow.empty()) {
+				m_copy_changed(entities_shadow, reinterpret_cast<uint8_t*>(archetype.entities.data()));
+				m_copy_changed(enabled_shadow, reinterpret_cast<uint8_t*>(archetype.enabled_rows.data()));
+			}
+
+			// Recount disabled rows
+			archetype.m_resize_rows(static_cast<uint32_t>(archetype.entities.size()));
+
+			archetype.size = shadow->size;
+		}
+
+		void rollback_buffer_t::m_restore_registry()
+		{
+			registry_t& registry = *m_registry;
+
+			// Recreate any archetypes that no longer exist
+			for (const auto& [signature, shadow] : m_archetypes) {
+				if (registry.m_get_archetype(signature) == nullptr)
+					registry.m_create_archetype(signature);
+			}
+
+			for (const auto& [signature, shadow] : m_prefabs) {
+				if (!registry.m_prefabs.contains(signature))
+					registry.m_create_prefab_archetype(signature);
+			}
+
+			for (auto& [signature, archetype] : registry.m_archetypes) {
+				auto it = m_archetypes.find(signature);
+
+				m_restore_archetype(archetype, it != m_archetypes.end() ? &it->second : nullptr);
+			}
+
+			for (auto& [signature, prefab] : registry.m_prefabs) {
+				auto it = m_prefabs.find(signature);
+
+				m_restore_archetype(prefab.storage, it != m_prefabs.end() ? &it->second : nullptr);
+			}
+
+			registry.m_entity_sparse.assign(
+				reinterpret_cast<const entity_t*>(m_entities.data()),
+				static_cast<uint32_t>(m_entities.size() / sizeof(entity_t))
+			);
+
+			// Shadow entities hold archetype pointers from when they were recorded, and those
+			// archetypes may have been deleted and recreated since, so rebind each entity to
+			// the archetype or prefab storage holding its row
+			entity_t* entities = registry.m_entity_sparse.data();
+
+			for (uint32_t i = 0; i < registry.m_entity_sparse.size(); i++) {
+				entities[i].archetype = nullptr;
+				entities[i].index = INVALID_INDEX;
+			}
+
+			auto rebind = [&registry](archetype_t& archetype) {
+				for (uint32_t row = 0; row < archetype.size; row++) {
+					entity_t& entity = registry.m_entity_sparse.at(archetype.entities[row]);
+
+					entity.archetype = &archetype;
+					entity.index = row;
+				}
+			};
+
+			for (auto& [signature, archetype] : registry.m_archetypes) {
+				rebind(archetype);
+			}
+
+			for (auto& [signature, prefab] : registry.m_prefabs) {
+				rebind(prefab.storage);
+			}
+
+			auto& entity_gen = registry.m_entity_gen;
+
+			entity_gen.created.resize(m_entity_ids.size() / sizeof(entity_value_t));
+
+			if (!m_entity_ids.empty())
+				std::memcpy(entity_gen.created.data(), m_entity_ids.data(), m_entity_ids.size());
+
+			entity_gen.available = m_entity_ids_available;
+			entity_gen.next = m_entity_ids_next;
+			entity_gen.new_counter = m_entity_ids_counter;
+		}
+
+		rollback_buffer_t::rollback_buffer_t(registry_t& registry, uint32_t max_checkpoints)
+			: m_registry(&registry), m_max_checkpoints(std::max(max_checkpoints, 1u)), m_has_checkpoint(false),
+			m_entity_ids_available(0), m_entity_ids_next(ENTITY_NULL_ID), m_entity_ids_counter(0)
+		{}
+
+		bool rollback_buffer_t::checkpoint()
+		{
+			registry_t& registry = *m_registry;
+
+			// Check before recording anything, so a failed checkpoint changes nothing
+			for (component_id_t i : registry.m_sparse_ids) {
+				if (registry.m_sparse_pools[i]->size() != 0) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Can't checkpoint sparse component {}, sparse pools aren't tracked", i);
+
+					return false;
+				}
+			}
+
+			for (const relation_storage_t& relation : registry.m_relations) {
+				if (!relation.empty()) {
+					VIVIUM_ECS_ERROR(severity::ERROR, "Can't checkpoint relations, they aren't tracked");
+
+					return false;
+				}
+			}
+
+			auto trivially_copyable = [&registry](const archetype_t& archetype) {
+				for (component_id_t i : archetype.component_ids) {
+					if (!registry.m_component_managers[i].trivially_copyable) {
+						VIVIUM_ECS_ERROR(severity::ERROR, "Can't checkpoint component {}, since it isn't trivially copyable", i);
+
+						return false;
+					}
+				}
+
+				return true;
+			};
+
+			for (const auto& [signature, archetype] : registry.m_archetypes) {
+				if (!trivially_copyable(archetype)) return false;
+			}
+
+			for (const auto& [signature, prefab] : registry.m_prefabs) {
+				if (!trivially_copyable(prefab.storage)) return false;
+			}
+
+			tick_delta_t delta;
+
+			for (const auto& [signature, archetype] : registry.m_archetypes) {
+				m_record_archetype(archetype, m_archetypes[signature], delta.archetypes);
+			}
+
+			for (const auto& [signature, prefab] : registry.m_prefabs) {
+				m_record_archetype(prefab.storage, m_prefabs[signature], delta.prefabs);
+			}
+
+			const auto& entity_gen = registry.m_entity_gen;
+
+			m_record(m_entities, reinterpret_cast<const uint8_t*>(registry.m_entity_sparse.data()),
+				registry.m_entity_sparse.size() * sizeof(entity_t), delta.entities);
+			m_record(m_entity_ids, reinterpret_cast<const uint8_t*>(entity_gen.created.data()),
+				static_cast<uint32_t>(entity_gen.created.size() * sizeof(entity_value_t)), delta.entity_ids);
+
+			delta.entity_ids_available = std::exchange(m_entity_ids_available, entity_gen.available);
+			delta.entity_ids_next = std::exchange(m_entity_ids_next, entity_gen.next);
+			delta.entity_ids_counter = std::exchange(m_entity_ids_counter, entity_gen.new_counter);
+
+			// First checkpoint has nothing to roll back to
+			if (m_has_checkpoint) {
+				m_deltas.push_back(std::move(delta));
+
+				while (m_deltas.size() >= m_max_checkpoints) {
+					m_deltas.pop_front();
+				}
+			}
+
+			m_has_checkpoint = true;
+
+			return true;
+		}
+
+		bool rollback_buffer_t::rollback(uint32_t checkpoints_ago)
+		{
+			if (!m_has_checkpoint) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to roll back without any checkpoints");
+
+				return false;
+			}
+
+			if (checkpoints_ago > m_deltas.size()) {
+				VIVIUM_ECS_ERROR(severity::ERROR, "Attempted to roll back {} checkpoints, but only {} are stored",
+					checkpoints_ago, m_deltas.size());
+
+				return false;
+			}
+
+			// Walk shadow back to requested checkpoint, newest delta first
+			for (uint32_t i = 0; i < checkpoints_ago; i++) {
+				const tick_delta_t& delta = m_deltas.back();
+
+				m_revert_archetypes(m_archetypes, delta.archetypes);
+				m_revert_archetypes(m_prefabs, delta.prefabs);
+
+				m_revert(m_entities, delta.entities);
+				m_revert(m_entity_ids, delta.entity_ids);
+
+				m_entity_ids_available = delta.entity_ids_available;
+				m_entity_ids_next = delta.entity_ids_next;
+				m_entity_ids_counter = delta.entity_ids_counter;
+
+				m_deltas.pop_back();
+			}
+
+			m_restore_registry();
+
+			return true;
+		}
+
+		uint32_t rollback_buffer_t::size() const
+		{
+			return m_has_checkpoint ? static_cast<uint32_t>(m_deltas.size()) + 1 : 0;
+		}
+
+		size_t rollback_buffer_t::delta_bytes() const
+		{
+			size_t bytes = 0;
+
+			for (const tick_delta_t& delta : m_deltas) {
+				for (const std::vector<archetype_delta_t>* deltas : { &delta.archetypes, &delta.prefabs }) {
+					for (const archetype_delta_t& archetype_delta : *deltas) {
+						for (const auto& [column, column_delta] : archetype_delta.columns) {
+							bytes += column_delta.old_bytes.size() + column_delta.chunk_offsets.size() * sizeof(uint32_t);
+						}
+					}
+				}
+
+				bytes += delta.entities.old_bytes.size() + delta.entities.chunk_offsets.size() * sizeof(uint32_t);
+				bytes += delta.entity_ids.old_bytes.size() + delta.entity_ids.chunk_offsets.size() * sizeof(uint32_t);
+			}
+
+			return bytes;
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "registry.h"
+
+#include <deque>
+#include <vector>
+
+namespace Vivium {
+	namespace ECS {
+		// Keeps the last N checkpoints of a registry as reverse deltas, so memory
+		// used is proportional to what changed between checkpoints, plus one copy
+		// of the world at the latest checkpoint that deltas are computed against.
+		// Changes are found by comparing chunks of bytes, so only trivially
+		// copyable components are supported
+		struct rollback_buffer_t {
+		private:
+			// Old contents of the chunks of a byte buffer that changed
+			struct buffer_delta_t {
+				uint32_t old_size = 0;
+				std::vector<uint32_t> chunk_offsets;
+				std::vector<uint8_t> old_bytes;
+			};
+
+			struct archetype_shadow_t {
+				uint32_t size = 0;
+				// One per enabled component, in order of component id, then the entity of each row,
+				// then the enabled bits of the rows
+				std::vector<std::vector<uint8_t>> columns;
+			};
+
+			struct archetype_delta_t {
+				signature_t signature;
+				uint32_t old_size;
+				std::vector<std::pair<uint32_t, buffer_delta_t>> columns;
+			};
+
+			// Undoes everything between one checkpoint and the one before it
+			struct tick_delta_t {
+				std::vector<archetype_delta_t> archetypes;
+				std::vector<archetype_delta_t> prefabs;
+
+				buffer_delta_t entities;
+				buffer_delta_t entity_ids;
+
+				uint32_t entity_ids_available;
+				entity_value_t entity_ids_next;
+				entity_value_t entity_ids_counter;
+			};
+
+			registry_t* m_registry;
+			uint32_t m_max_checkpoints;
+			bool m_has_checkpoint;
+
+			// State of registry at latest checkpoint
+			std::unordered_map<signature_t, archetype_shadow_t> m_archetypes;
+			// Prefab storage, kept apart since prefabs share signatures with archetypes
+			std::unordered_map<signature_t, archetype_shadow_t> m_prefabs;
+			std::vector<uint8_t> m_entities;
+			std::vector<uint8_t> m_entity_ids;
+
+			uint32_t m_entity_ids_available;
+			entity_value_t m_entity_ids_next;
+			entity_value_t m_entity_ids_counter;
+
+			// Newest delta at the back
+			std::deque<tick_delta_t> m_deltas;
+
+			// Record chunks where shadow differs from current into delta, then update shadow to match
+			static bool m_record(std::vector<uint8_t>& shadow, const uint8_t* current, uint32_t current_size, buffer_delta_t& delta);
+			// Revert shadow to the state before the delta was recorded
+			static void m_revert(std::vector<uint8_t>& shadow, const buffer_delta_t& delta);
+			// Copy chunks of shadow that differ to destination, which must be the same size
+			static void m_copy_changed(const std::vector<uint8_t>& shadow, uint8_t* destination);
+
+			// Record columns, entities and enabled bits of archetype into its shadow, adding
+			// a delta to deltas if anything changed
+			static void m_record_archetype(const archetype_t& archetype, archetype_shadow_t& shadow, std::vector<archetype_delta_t>& deltas);
+			static void m_revert_archetypes(std::unordered_map<signature_t, archetype_shadow_t>& shadows, const std::vector<archetype_delta_t>& deltas);
+			// Make archetype match its shadow, or empty it if it had none
+			static void m_restore_archetype(archetype_t& archetype, const archetype_shadow_t* shadow);
+
+			// Make registry match state of latest checkpoint
+			void m_restore_registry();
+
+		public:
+			// Keeps enough history to roll back max_checkpoints - 1 checkpoints
+			rollback_buffer_t(registry_t& registry, uint32_t max_checkpoints);
+
+			// Record the current state of the registry, returns false if the registry
+			// contains components that aren't trivially copyable, or any sparse components
+			// or relations
+			bool checkpoint();
+
+			// Restore registry to the state it was in checkpoints_ago checkpoints
+			// before the latest one, discarding any newer checkpoints
+			bool rollback(uint32_t checkpoints_ago = 0);
+
+			// Amount of checkpoints that can be restored
+			uint32_t size() const;
+
+			// Bytes currently used to store deltas
+			size_t delta_bytes() const;
+		};
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+namespace Vivium {
+	namespace ECS {
+		// Specialise for non-trivially copyable components to allow them to be
+		// written to/read from snapshots, expects:
+		//	static void save(std::ostream& stream, const T& component);
+		//	static T load(std::istream& stream);
+		template <typename T>
+		struct component_serializer;
+
+		template <typename T>
+		concept has_component_serializer = requires (std::ostream& out, std::istream& in, const T& component) {
+			component_serializer<T>::save(out, component);
+			{ component_serializer<T>::load(in) } -> std::convertible_to<T>;
+		};
+
+		template <typename T>
+		concept is_snapshot_serializable = std::is_trivially_copyable_v<T> || has_component_serializer<T>;
+
+		template <typename T>
+		void write_raw(std::ostream& stream, const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>, "Can only write trivially copyable types raw");
+
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template <typename T>
+		bool read_raw(std::istream& stream, T& value) {
+			static_assert(std::is_trivially_copyable_v<T>, "Can only read trivially copyable types raw");
+
+			return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+		}
+	}
+}
@@ -11,5 +11,34 @@ namespace Vivium {
 		bool signature_t::operator!=(const signature_t& other) const {
 			return enabled != other.enabled;
 		}
+
+		void signature_t::serialize(std::ostream& stream) const {
+			// Pack bitset into 64-bit words, since bitset has no portable layout
+			for (uint32_t word = 0; word < MAX_COMPONENTS / 64; word++) {
+				uint64_t bits = 0;
+
+				for (uint32_t bit = 0; bit < 64; bit++) {
+					bits |= static_cast<uint64_t>(enabled.test(word * 64 + bit)) << bit;
+				}
+
+				write_raw(stream, bits);
+			}
+		}
+
+		bool signature_t::deserialize(std::istream& stream) {
+			enabled.reset();
+
+			for (uint32_t word = 0; word < MAX_COMPONENTS / 64; word++) {
+				uint64_t bits = 0;
+
+				if (!read_raw(stream, bits)) return false;
+
+				for (uint32_t bit = 0; bit < 64; bit++) {
+					enabled.set(word * 64 + bit, (bits >> bit) & 1);
+				}
+			}
+
+			return true;
+		}
 	}
 }
\ No newline at end of file
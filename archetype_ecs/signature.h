@@ -2,6 +2,7 @@
 
 #include "constants.h"
 #include "component_registry.h"
+#include "serialization.h"
 
 #include <bitset>
 
@@ -15,6 +16,9 @@ namespace Vivium {
 			bool operator==(const signature_t& other) const;
 			bool operator!=(const signature_t& other) const;
 
+			void serialize(std::ostream& stream) const;
+			bool deserialize(std::istream& stream);
+
 			template <typename... Ts>
 			void setup(registry_id_t registry) {
 				([&]() {
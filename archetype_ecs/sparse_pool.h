@@ -0,0 +1,164 @@
+#pragma once
+
+#include "component.h"
+#include "paged_array.h"
+#include "constants.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace Vivium {
+	namespace ECS {
+		// Components of one type stored outside of archetypes, packed densely and keyed by
+		// entity, so adding or removing one never moves the entity's other components
+		struct sparse_pool_t {
+		private:
+			// Row of each entity in the pool, INVALID_INDEX if entity doesn't have the component
+			paged_array_t<uint32_t, MAX_ENTITIES, ENTITY_SPARSE_PAGE_SIZE, INVALID_INDEX> m_indices;
+
+			// Swap remove entity from its row, after its component was removed from the same row
+			void m_remove_row(uint32_t index, entity_value_t entity) {
+				entity_value_t last = entities.back();
+				entities[index] = last;
+				entities.pop_back();
+
+				m_indices.pop(entity);
+
+				if (last != entity)
+					m_indices.at(last) = index;
+			}
+
+		public:
+			component_array_t components;
+			// Entity stored in each row
+			std::vector<entity_value_t> entities;
+
+			sparse_pool_t(const component_manager_t& manager)
+				: components(manager)
+			{}
+
+			uint32_t size() const { return static_cast<uint32_t>(entities.size()); }
+
+			// Returns INVALID_INDEX if entity doesn't have the component
+			uint32_t index_of(entity_value_t entity) const { return m_indices.at(entity); }
+			bool contains(entity_value_t entity) const { return index_of(entity) != INVALID_INDEX; }
+
+			// Construct component for entity from args, replacing any it already had
+			template <typename T, typename... Args>
+			T& emplace(entity_value_t entity, Args&&... args) {
+				uint32_t index = index_of(entity);
+
+				if (index != INVALID_INDEX) {
+					components.emplace_at<T>(index, std::forward<Args>(args)...);
+				}
+				else {
+					index = size();
+
+					components.emplace_back<T>(std::forward<Args>(args)...);
+					entities.push_back(entity);
+					m_indices.push(entity, index);
+				}
+
+				return components.at<T>(index);
+			}
+
+			template <typename T>
+			T& at(entity_value_t entity) {
+				uint32_t index = index_of(entity);
+
+				VIVIUM_ECS_CHECK(index != INVALID_INDEX, severity::FATAL, "Entity {} doesn't have sparse component {}", entity, typeid(T).name());
+
+				return components.at<T>(index);
+			}
+
+			template <typename T>
+			const T& at(entity_value_t entity) const {
+				uint32_t index = index_of(entity);
+
+				VIVIUM_ECS_CHECK(index != INVALID_INDEX, severity::FATAL, "Entity {} doesn't have sparse component {}", entity, typeid(T).name());
+
+				return components.at<T>(index);
+			}
+
+			// Swap remove component of entity, returns false if it didn't have one
+			bool erase(entity_value_t entity) {
+				uint32_t index = index_of(entity);
+
+				if (index == INVALID_INDEX) return false;
+
+				components.erase(index);
+				m_remove_row(index, entity);
+
+				return true;
+			}
+
+			// Move component of entity to the end of other, stored there for other_entity.
+			// Returns false if entity didn't have one
+			bool transfer_to(entity_value_t entity, sparse_pool_t& other, entity_value_t other_entity) {
+				uint32_t index = index_of(entity);
+
+				if (index == INVALID_INDEX) return false;
+
+				other.m_indices.push(other_entity, other.size());
+				other.entities.push_back(other_entity);
+
+				components.transfer_index_to_end_of(index, other.components);
+				m_remove_row(index, entity);
+
+				return true;
+			}
+
+			// Move every component to the end of other, where entity_map gives the value in
+			// other of each entity here. Leaves this pool empty
+			void append_all_to(sparse_pool_t& other, const entity_value_t* entity_map) {
+				components.append_all_to(other.components);
+
+				for (entity_value_t entity : entities) {
+					other.m_indices.push(entity_map[entity], other.size());
+					other.entities.push_back(entity_map[entity]);
+				}
+
+				entities.clear();
+				m_indices.clear();
+			}
+
+			void clear() {
+				components.clear();
+				entities.clear();
+				m_indices.clear();
+			}
+
+			void shrink_to_fit() {
+				components.shrink_to_fit();
+				entities.shrink_to_fit();
+				m_indices.shrink_to_fit();
+			}
+
+			size_t memory_usage() const {
+				return sizeof(sparse_pool_t) + components.memory_usage()
+					+ entities.capacity() * sizeof(entity_value_t) + m_indices.memory_usage();
+			}
+
+			uint32_t index_page_count() const { return m_indices.page_count(); }
+
+			void clone_from(const sparse_pool_t& other) {
+				components.clone_from(other.components);
+				entities = other.entities;
+				m_indices = other.m_indices;
+			}
+
+			// Rebuild entity lookups after entities and components were filled directly
+			void rebuild_indices() {
+				m_indices.clear();
+
+				for (uint32_t index = 0; index < size(); index++) {
+					m_indices.push(entities[index], index);
+				}
+			}
+		};
+
+		// Pool of each sparse component, indexed by component id, null for other components
+		using sparse_pools_t = std::array<std::unique_ptr<sparse_pool_t>, MAX_COMPONENTS>;
+	}
+}
@@ -3,6 +3,10 @@
 #include "error_handler.h"
 #include "paged_array.h"
 #include "constants.h"
+#include "profiling.h"
+
+#include <cstring>
+#include <vector>
 
 namespace Vivium {
 	namespace ECS {
@@ -16,17 +20,79 @@ namespace Vivium {
 			paged_array_t<key_t, max_size, page_size, null_value> m_sparse_array;
 
 		public:
-			uint32_t get_index_of(const key_t& key) {
+			uint32_t get_index_of(const key_t& key) const {
+				VIVIUM_ECS_PROFILE_COUNT(SPARSE_LOOKUPS);
+
 				const uint32_t index = m_sparse_array.at(key);
 
-				if (index == null_value) {
-					VIVIUM_ECS_ERROR(severity::FATAL, "Key was invalid, got null value from sparse array");
-				}
+				VIVIUM_ECS_CHECK(index != null_value, severity::FATAL, "Key was invalid, got null value from sparse array");
 
 				return index;
 			}
 
 			uint32_t size() const { return m_dense_array.size(); }
+			uint32_t capacity() const { return m_dense_array.capacity(); }
+
+			// Iterate dense array
+			auto begin() const { return m_dense_array.begin(); }
+			auto end() const { return m_dense_array.end(); }
+
+			void reserve(uint32_t capacity) {
+				m_dense_array.reserve(capacity);
+			}
+
+			void clear() {
+				m_dense_array.clear();
+				m_sparse_array.clear();
+			}
+
+			void shrink_to_fit() {
+				m_dense_array.shrink_to_fit();
+				m_sparse_array.shrink_to_fit();
+			}
+
+			size_t memory_usage() const {
+				return m_dense_array.capacity() * sizeof(value_t) + m_sparse_array.memory_usage();
+			}
+
+			uint32_t page_count() const { return m_sparse_array.page_count(); }
+
+			value_t* data() { return m_dense_array.data(); }
+			const value_t* data() const { return m_dense_array.data(); }
+
+			// Replace dense array with the given values, only updating sparse
+			// entries for slots which changed
+			void assign(const value_t* values, uint32_t count) {
+				static_assert(std::is_trivially_copyable_v<value_t>, "Slots are compared bytewise");
+
+				uint32_t old_count = m_dense_array.size();
+
+				auto changed = [&](uint32_t index) {
+					return index >= old_count || std::memcmp(&m_dense_array[index], &values[index], sizeof(value_t)) != 0;
+				};
+
+				// Remove keys of slots which are changing, before any are re-added
+				for (uint32_t index = 0; index < old_count; index++) {
+					if (index >= count || changed(index)) {
+						m_sparse_array.pop(key_func(m_dense_array[index]));
+					}
+				}
+
+				std::vector<bool> slot_changed(count);
+
+				for (uint32_t index = 0; index < count; index++) {
+					slot_changed[index] = changed(index);
+				}
+
+				m_dense_array.resize(count);
+
+				for (uint32_t index = 0; index < count; index++) {
+					if (slot_changed[index]) {
+						m_dense_array[index] = values[index];
+						m_sparse_array.push(key_func(values[index]), index);
+					}
+				}
+			}
 
 			value_t& at(const key_t& key) {
 				return m_dense_array[get_index_of(key)];
@@ -65,8 +131,8 @@ namespace Vivium {
 
 				std::swap(last_element_sparse, current_element_sparse);
 
-				// Remove element at index
-				m_sparse_array.pop(last_key);
+				// Last key now points at the erased slot, so remove the erased key
+				m_sparse_array.pop(element_key);
 			}
 		};
 	}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+	// Resident set size of this process in bytes, 0 if unsupported
+	inline size_t current_rss() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.WorkingSetSize;
+
+		return 0;
+#elif defined(__linux__)
+		FILE* file = std::fopen("/proc/self/statm", "r");
+
+		if (file == nullptr) return 0;
+
+		long pages = 0, resident = 0;
+		int read = std::fscanf(file, "%ld %ld", &pages, &resident);
+
+		std::fclose(file);
+
+		return read == 2 ? static_cast<size_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+#else
+		return 0;
+#endif
+	}
+
+	// Peak resident set size of this process in bytes, 0 if unsupported
+	inline size_t peak_rss() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+
+		return 0;
+#else
+		rusage usage;
+
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss);
+#else
+		// Reported in kilobytes
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	}
+}
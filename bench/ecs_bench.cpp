@@ -0,0 +1,442 @@
+#include <benchmark/benchmark.h>
+
+#include "archetype_ecs.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Vivium::ECS;
+
+namespace {
+	struct position_t {
+		float x, y, z;
+	};
+
+	struct velocity_t {
+		float x, y, z;
+	};
+
+	// Not trivial, but trivially copyable
+	struct health_t {
+		float value = 100.0f;
+	};
+
+	// Not trivially copyable, moved bytewise only once opted in below
+	struct inventory_t {
+		std::vector<uint32_t> items;
+	};
+
+	struct relocatable_inventory_t {
+		std::vector<uint32_t> items;
+	};
+
+	// Toggled often, so kept in archetypes or a sparse pool
+	struct burning_t {
+		float damage;
+	};
+
+	struct sparse_burning_t {
+		float damage;
+	};
+
+	// Handle of the entity owning the row, to look up relations while iterating
+	struct node_t {
+		entity_value_t entity;
+	};
+}
+
+template <>
+struct Vivium::ECS::is_trivially_relocatable<relocatable_inventory_t> : std::true_type {};
+
+template <>
+struct Vivium::ECS::component_storage_policy<sparse_burning_t>
+	: std::integral_constant<storage_policy, storage_policy::SPARSE> {};
+
+namespace {
+	void register_components(registry_t& registry) {
+		registry.register_component<position_t>();
+		registry.register_component<velocity_t>();
+		registry.register_component<health_t>();
+		registry.register_component<inventory_t>();
+		registry.register_component<relocatable_inventory_t>();
+		registry.register_component<burning_t>();
+		registry.register_component<sparse_burning_t>();
+	}
+
+	std::vector<entity_value_t> populate(registry_t& registry, uint32_t count) {
+		std::vector<entity_value_t> entities;
+		entities.reserve(count);
+
+		for (uint32_t i = 0; i < count; i++) {
+			entity_value_t entity = registry.get_entity();
+
+			registry.push_component<position_t>(entity, position_t{ float(i), 0.0f, 0.0f });
+			entities.push_back(entity);
+		}
+
+		return entities;
+	}
+}
+
+static void entity_create_destroy(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+
+	for (auto _ : state) {
+		std::vector<entity_value_t> entities = populate(registry, count);
+
+		for (entity_value_t entity : entities) {
+			registry.free_entity(entity);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void component_add_remove(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	std::vector<entity_value_t> entities = populate(registry, count);
+
+	for (auto _ : state) {
+		for (entity_value_t entity : entities) {
+			registry.push_component<velocity_t>(entity, velocity_t{ 1.0f, 0.0f, 0.0f });
+		}
+
+		for (entity_value_t entity : entities) {
+			registry.remove_component<velocity_t>(entity);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+// Same transition as component_add_remove, moving every entity in one batch
+static void component_add_remove_bulk(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	std::vector<entity_value_t> entities = populate(registry, count);
+
+	for (auto _ : state) {
+		registry.add_component_to(entities, velocity_t{ 1.0f, 0.0f, 0.0f });
+
+		for (entity_value_t entity : entities) {
+			registry.remove_component<velocity_t>(entity);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+// Moves a non-trivial component between archetypes, along with position
+template <typename T>
+static void component_add_remove_non_trivial(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	std::vector<entity_value_t> entities = populate(registry, count);
+
+	for (entity_value_t entity : entities) {
+		registry.push_component<T>(entity, T{});
+	}
+
+	for (auto _ : state) {
+		for (entity_value_t entity : entities) {
+			registry.push_component<velocity_t>(entity, velocity_t{ 1.0f, 0.0f, 0.0f });
+		}
+
+		for (entity_value_t entity : entities) {
+			registry.remove_component<velocity_t>(entity);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+// Add and remove a component on entities that have several others
+template <typename T>
+static void component_toggle(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	std::vector<entity_value_t> entities;
+
+	for (uint32_t i = 0; i < count; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_components<position_t, velocity_t, health_t, inventory_t>(entities.back(),
+			position_t{}, velocity_t{}, health_t{}, inventory_t{ std::vector<uint32_t>(4) });
+	}
+
+	for (auto _ : state) {
+		for (entity_value_t entity : entities) {
+			registry.push_component<T>(entity, T{ 1.0f });
+		}
+
+		for (entity_value_t entity : entities) {
+			registry.remove_component<T>(entity);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+static void get_component_random(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	std::vector<entity_value_t> entities = populate(registry, count);
+
+	std::shuffle(entities.begin(), entities.end(), std::mt19937(42));
+
+	for (auto _ : state) {
+		float sum = 0.0f;
+
+		for (entity_value_t entity : entities) {
+			sum += registry.get_component<position_t>(entity).x;
+		}
+
+		benchmark::DoNotOptimize(sum);
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void iterate(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+
+	for (uint32_t i = 0; i < count; i++) {
+		registry.push_components<position_t, velocity_t>(registry.get_entity(),
+			position_t{ 0.0f, 0.0f, 0.0f }, velocity_t{ 1.0f, 1.0f, 1.0f });
+	}
+
+	for (auto _ : state) {
+		for (auto it = registry.begin<position_t, velocity_t>(); it != registry.end<position_t, velocity_t>(); ++it) {
+			auto [position, velocity] = *it;
+
+			position.x += velocity.x;
+			position.y += velocity.y;
+			position.z += velocity.z;
+		}
+
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Iterate with every other run of 64 entities disabled, as pooled entities would be
+static void iterate_partially_disabled(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+
+	for (uint32_t i = 0; i < count; i++) {
+		entity_value_t entity = registry.get_entity();
+
+		registry.push_components<position_t, velocity_t>(entity,
+			position_t{ 0.0f, 0.0f, 0.0f }, velocity_t{ 1.0f, 1.0f, 1.0f });
+
+		if ((i / 64) % 2 == 1)
+			registry.set_enabled(entity, false);
+	}
+
+	for (auto _ : state) {
+		for (auto it = registry.begin<position_t, velocity_t>(); it != registry.end<position_t, velocity_t>(); ++it) {
+			auto [position, velocity] = *it;
+
+			position.x += velocity.x;
+			position.y += velocity.y;
+			position.z += velocity.z;
+		}
+
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count / 2);
+}
+
+// Propagate world positions down a random tree in one pass, after ordering rows by depth
+static void hierarchy_propagate(benchmark::State& state) {
+	struct child_of_t {};
+
+	registry_t registry;
+	register_components(registry);
+	registry.register_component<node_t>();
+
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	std::vector<entity_value_t> nodes;
+
+	for (uint32_t i = 0; i < count; i++) {
+		nodes.push_back(registry.get_entity());
+	}
+
+	std::mt19937 random(42);
+
+	// Parent is always an earlier node, rows are filled in shuffled order so the sort has work to do
+	for (uint32_t i = 1; i < count; i++) {
+		registry.set_parent<child_of_t>(nodes[i], nodes[random() % i]);
+	}
+
+	std::vector<entity_value_t> shuffled = nodes;
+	std::shuffle(shuffled.begin(), shuffled.end(), random);
+
+	for (entity_value_t node : shuffled) {
+		registry.push_components<position_t, node_t>(node, position_t{ 1.0f, 0.0f, 0.0f }, node_t{ node });
+	}
+
+	registry.sort_hierarchy<child_of_t>();
+
+	for (auto _ : state) {
+		auto end = registry.end<position_t, node_t>();
+
+		for (auto it = registry.begin<position_t, node_t>(); it != end; ++it) {
+			auto [position, node] = *it;
+
+			entity_value_t parent = registry.parent_of<child_of_t>(node.entity);
+
+			position.y = position.x + (parent != ENTITY_NULL ? registry.get_component<position_t>(parent).y : 0.0f);
+		}
+
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Re-sort 100k rows by a key after changing the given number of keys
+static void sort_rows(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	uint32_t count = 100000;
+	uint32_t changed = static_cast<uint32_t>(state.range(0));
+	std::vector<entity_value_t> entities = populate(registry, count);
+
+	std::mt19937 random(42);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+
+		for (uint32_t i = 0; i < changed; i++) {
+			registry.get_component<position_t>(entities[random() % count]).x = float(random() % count);
+		}
+
+		state.ResumeTiming();
+
+		registry.sort<position_t>([](const position_t& a, const position_t& b) { return a.x < b.x; });
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Stream a cell built in its own registry into the live one, by rebuilding each entity
+// or by merging whole columns
+static void cell_stream_in(benchmark::State& state) {
+	uint32_t count = 20000;
+	bool merge = state.range(0) != 0;
+
+	for (auto _ : state) {
+		state.PauseTiming();
+
+		auto live = std::make_unique<registry_t>();
+		register_components(*live);
+
+		auto cell = std::make_unique<registry_t>();
+		cell->register_component<velocity_t>();
+		cell->register_component<position_t>();
+
+		std::vector<entity_value_t> built;
+
+		for (uint32_t i = 0; i < count; i++) {
+			built.push_back(cell->get_entity());
+			cell->push_components<position_t, velocity_t>(built.back(), position_t{ float(i), 0.0f, 0.0f }, velocity_t{ 1.0f, 0.0f, 0.0f });
+		}
+
+		state.ResumeTiming();
+
+		if (merge) {
+			benchmark::DoNotOptimize(live->merge_from(*cell));
+		}
+		else {
+			for (entity_value_t entity : built) {
+				entity_value_t copy = live->get_entity();
+
+				live->push_components<position_t, velocity_t>(copy, cell->get_component<position_t>(entity), cell->get_component<velocity_t>(entity));
+				cell->free_entity(entity);
+			}
+		}
+
+		state.PauseTiming();
+
+		live.reset();
+		cell.reset();
+
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Global data read as a component of a dummy entity, versus as a resource
+static void singleton_component(benchmark::State& state) {
+	registry_t registry;
+	register_components(registry);
+
+	entity_value_t singleton = registry.get_entity();
+	registry.push_component<health_t>(singleton, health_t{ 1.0f });
+
+	for (auto _ : state) {
+		float& value = registry.get_component<health_t>(singleton).value;
+		value += 1.0f;
+
+		benchmark::DoNotOptimize(value);
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void singleton_resource(benchmark::State& state) {
+	registry_t registry;
+	registry.emplace_resource<health_t>(health_t{ 1.0f });
+
+	for (auto _ : state) {
+		float& value = registry.resource<health_t>().value;
+		value += 1.0f;
+
+		benchmark::DoNotOptimize(value);
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(entity_create_destroy)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(component_add_remove)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(component_add_remove_bulk)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(component_add_remove_non_trivial<health_t>)->Arg(1 << 16);
+BENCHMARK(component_add_remove_non_trivial<inventory_t>)->Arg(1 << 16);
+BENCHMARK(component_add_remove_non_trivial<relocatable_inventory_t>)->Arg(1 << 16);
+BENCHMARK(component_toggle<burning_t>)->Arg(1 << 16);
+BENCHMARK(component_toggle<sparse_burning_t>)->Arg(1 << 16);
+BENCHMARK(get_component_random)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(iterate)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK(iterate_partially_disabled)->Arg(1 << 16);
+BENCHMARK(hierarchy_propagate)->Arg(100000);
+BENCHMARK(sort_rows)->Arg(0)->Arg(100)->Arg(100000);
+BENCHMARK(cell_stream_in)->Arg(0)->Arg(1);
+BENCHMARK(singleton_component);
+BENCHMARK(singleton_resource);
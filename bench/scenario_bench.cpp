@@ -0,0 +1,278 @@
+// Scenarios modelled on common ECS benchmark suites, for tracking how registry_t
+// scales. Run with --benchmark_out=results.json --benchmark_out_format=json to
+// record results for trend tracking, the ecs_bench_json target does this.
+//
+// Reported counters:
+//	items_per_second	operations per second, invert for ns/op
+//	bytes_per_entity	growth in resident memory while building the world, per entity
+//	peak_rss_mb			peak resident memory of the whole process so far
+
+#include <benchmark/benchmark.h>
+
+#include "archetype_ecs.h"
+#include "bench_memory.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace Vivium::ECS;
+
+namespace {
+	// Distinct component types, so worlds can have many components and archetypes
+	template <uint32_t N>
+	struct data_t {
+		float value[4];
+	};
+
+	constexpr uint32_t FRAGMENT_COMPONENTS = 12;
+
+	template <uint32_t... Ns>
+	void register_data(registry_t& registry, std::integer_sequence<uint32_t, Ns...>) {
+		(registry.register_component<data_t<Ns>>(), ...);
+	}
+
+	// Push every data component whose bit is set in mask
+	template <uint32_t... Ns>
+	void push_masked(registry_t& registry, entity_value_t entity, uint32_t mask, std::integer_sequence<uint32_t, Ns...>) {
+		([&]() {
+			if (mask & (1u << Ns))
+				registry.push_component<data_t<Ns>>(entity, data_t<Ns>{});
+		}(), ...);
+	}
+
+	template <uint32_t... Ns>
+	void push_all(registry_t& registry, entity_value_t entity, std::integer_sequence<uint32_t, Ns...>) {
+		registry.push_components<data_t<Ns>...>(entity, data_t<Ns>{}...);
+	}
+
+	std::unique_ptr<registry_t> make_registry() {
+		std::unique_ptr<registry_t> registry = std::make_unique<registry_t>();
+
+		register_data(*registry, std::make_integer_sequence<uint32_t, FRAGMENT_COMPONENTS>{});
+
+		return registry;
+	}
+
+	template <uint32_t component_count>
+	std::vector<entity_value_t> populate(registry_t& registry, uint32_t count) {
+		std::vector<entity_value_t> entities;
+		entities.reserve(count);
+
+		for (uint32_t i = 0; i < count; i++) {
+			entity_value_t entity = registry.get_entity();
+
+			push_all(registry, entity, std::make_integer_sequence<uint32_t, component_count>{});
+			entities.push_back(entity);
+		}
+
+		return entities;
+	}
+
+	// One archetype per combination of the fragment components
+	std::vector<entity_value_t> populate_fragmented(registry_t& registry, uint32_t count, uint32_t archetype_count) {
+		std::vector<entity_value_t> entities;
+		entities.reserve(count);
+
+		for (uint32_t i = 0; i < count; i++) {
+			entity_value_t entity = registry.get_entity();
+
+			// Offset by one, since an entity needs at least one component
+			push_masked(registry, entity, i % archetype_count + 1, std::make_integer_sequence<uint32_t, FRAGMENT_COMPONENTS>{});
+			entities.push_back(entity);
+		}
+
+		return entities;
+	}
+
+	void report_memory(benchmark::State& state, size_t rss_before, uint32_t entity_count) {
+		size_t rss_after = bench::current_rss();
+
+		state.counters["bytes_per_entity"] = rss_after > rss_before
+			? double(rss_after - rss_before) / entity_count : 0.0;
+		state.counters["peak_rss_mb"] = double(bench::peak_rss()) / (1024.0 * 1024.0);
+	}
+}
+
+template <uint32_t component_count>
+static void scenario_create_world(benchmark::State& state) {
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		std::unique_ptr<registry_t> registry = make_registry();
+		size_t rss_before = bench::current_rss();
+		state.ResumeTiming();
+
+		populate<component_count>(*registry, count);
+
+		state.PauseTiming();
+		report_memory(state, rss_before, count);
+		registry.reset();
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+template <uint32_t component_count>
+static void scenario_iterate_world(benchmark::State& state) {
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+
+	std::unique_ptr<registry_t> registry = make_registry();
+	populate<component_count>(*registry, count);
+
+	for (auto _ : state) {
+		// Update the first component from the second, the others just widen the archetype
+		[&]<uint32_t... Ns>(std::integer_sequence<uint32_t, Ns...>) {
+			auto end = registry->end<data_t<Ns>...>();
+
+			for (auto it = registry->begin<data_t<Ns>...>(); it != end; ++it) {
+				it.template get<data_t<0>>().value[0] += it.template get<data_t<1>>().value[0];
+			}
+		}(std::make_integer_sequence<uint32_t, component_count>{});
+
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void scenario_create_fragmented(benchmark::State& state) {
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	uint32_t archetype_count = static_cast<uint32_t>(state.range(1));
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		std::unique_ptr<registry_t> registry = make_registry();
+		size_t rss_before = bench::current_rss();
+		state.ResumeTiming();
+
+		populate_fragmented(*registry, count, archetype_count);
+
+		state.PauseTiming();
+		report_memory(state, rss_before, count);
+		registry.reset();
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void scenario_archetype_churn(benchmark::State& state) {
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+	uint32_t archetype_count = static_cast<uint32_t>(state.range(1));
+
+	std::unique_ptr<registry_t> registry = make_registry();
+	std::vector<entity_value_t> entities = populate_fragmented(*registry, count, archetype_count);
+
+	std::mt19937 random(42);
+	std::uniform_int_distribution<uint32_t> pick(0, count - 1);
+
+	const uint32_t OPERATIONS = 10000;
+
+	for (auto _ : state) {
+		// Every entity has data_t<0> or data_t<1>, so toggling data_t<11> never empties it
+		for (uint32_t i = 0; i < OPERATIONS; i++) {
+			entity_value_t entity = entities[pick(random)];
+
+			registry->push_component<data_t<11>>(entity, data_t<11>{});
+			registry->remove_component<data_t<11>>(entity);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * OPERATIONS * 2);
+}
+
+static void scenario_sparse_get_component(benchmark::State& state) {
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+
+	std::unique_ptr<registry_t> registry = make_registry();
+	std::vector<entity_value_t> entities = populate<2>(*registry, count);
+
+	// Touch a random 1% of the world
+	std::shuffle(entities.begin(), entities.end(), std::mt19937(42));
+	entities.resize(std::max(count / 100, 1u));
+
+	for (auto _ : state) {
+		float sum = 0.0f;
+
+		for (entity_value_t entity : entities) {
+			sum += registry->get_component<data_t<1>>(entity).value[0];
+		}
+
+		benchmark::DoNotOptimize(sum);
+	}
+
+	state.SetItemsProcessed(state.iterations() * entities.size());
+}
+
+static void scenario_mixed_frame(benchmark::State& state) {
+	uint32_t count = static_cast<uint32_t>(state.range(0));
+
+	std::unique_ptr<registry_t> registry = make_registry();
+
+	// Movers have position/velocity, actors additionally have health
+	std::vector<entity_value_t> movers = populate<2>(*registry, count);
+	std::vector<entity_value_t> actors = populate<3>(*registry, count / 10);
+
+	std::mt19937 random(42);
+	std::uniform_int_distribution<uint32_t> pick(0, count - 1);
+
+	for (auto _ : state) {
+		// Movement system
+		auto movers_end = registry->end<data_t<0>, data_t<1>>();
+
+		for (auto it = registry->begin<data_t<0>, data_t<1>>(); it != movers_end; ++it) {
+			auto [position, velocity] = *it;
+
+			position.value[0] += velocity.value[0];
+		}
+
+		// Health system
+		auto actors_end = registry->end<data_t<0>, data_t<1>, data_t<2>>();
+
+		for (auto it = registry->begin<data_t<0>, data_t<1>, data_t<2>>(); it != actors_end; ++it) {
+			it.get<data_t<2>>().value[0] -= 1.0f;
+		}
+
+		// Targeting, random lookups
+		float sum = 0.0f;
+
+		for (uint32_t i = 0; i < count / 100; i++) {
+			sum += registry->get_component<data_t<0>>(movers[pick(random)]).value[0];
+		}
+
+		benchmark::DoNotOptimize(sum);
+
+		// Spawn and despawn 1%
+		for (uint32_t i = 0; i < count / 100; i++) {
+			uint32_t index = pick(random);
+
+			registry->free_entity(movers[index]);
+
+			movers[index] = registry->get_entity();
+			registry->push_components<data_t<0>, data_t<1>>(movers[index], data_t<0>{}, data_t<1>{});
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * (count + count / 10));
+}
+
+constexpr int64_t MILLION = 1 << 20;
+
+BENCHMARK(scenario_create_world<2>)->Arg(MILLION)->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(scenario_create_world<4>)->Arg(MILLION)->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(scenario_create_world<8>)->Arg(MILLION)->Unit(benchmark::kMillisecond)->Iterations(3);
+
+BENCHMARK(scenario_iterate_world<2>)->Arg(MILLION)->Unit(benchmark::kMillisecond);
+BENCHMARK(scenario_iterate_world<4>)->Arg(MILLION)->Unit(benchmark::kMillisecond);
+BENCHMARK(scenario_iterate_world<8>)->Arg(MILLION)->Unit(benchmark::kMillisecond);
+
+BENCHMARK(scenario_create_fragmented)->Args({ 1 << 16, 4095 })->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(scenario_archetype_churn)->Args({ 1 << 16, 256 })->Args({ 1 << 16, 4095 })->Unit(benchmark::kMillisecond);
+
+BENCHMARK(scenario_sparse_get_component)->Arg(MILLION);
+BENCHMARK(scenario_mixed_frame)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include "archetype_ecs.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace Vivium::ECS;
+
+TEST(ring_buffer, keeps_most_recent_values_when_full) {
+	ring_buffer_t<int, 8> buffer;
+
+	for (int i = 0; i < 20; i++) {
+		buffer.push_overwrite(i);
+	}
+
+	EXPECT_EQ(buffer.size(), 8);
+
+	std::vector<int> values;
+	buffer.for_each([&](int value) { values.push_back(value); });
+
+	EXPECT_EQ(values, std::vector<int>({ 12, 13, 14, 15, 16, 17, 18, 19 }));
+
+	int oldest = 0;
+	ASSERT_TRUE(buffer.try_pop(oldest));
+	EXPECT_EQ(oldest, 12);
+
+	buffer.clear();
+	EXPECT_TRUE(buffer.empty());
+}
+
+TEST(ring_buffer, concurrent_pushes_are_not_lost) {
+	constexpr int THREADS = 4;
+	constexpr int PUSHES = 10000;
+
+	ring_buffer_t<int, 1024> buffer;
+	std::vector<std::thread> producers;
+
+	std::vector<int> seen(THREADS * PUSHES, 0);
+	int popped = 0;
+
+	for (int thread = 0; thread < THREADS; thread++) {
+		producers.emplace_back([&buffer, thread]() {
+			for (int i = 0; i < PUSHES; i++) {
+				while (!buffer.try_push(thread * PUSHES + i)) std::this_thread::yield();
+			}
+		});
+	}
+
+	while (popped < THREADS * PUSHES) {
+		int value = 0;
+
+		if (buffer.try_pop(value)) {
+			++seen[value];
+			++popped;
+		}
+	}
+
+	for (std::thread& producer : producers) producer.join();
+
+	EXPECT_TRUE(buffer.empty());
+	EXPECT_EQ(std::count(seen.begin(), seen.end(), 1), THREADS * PUSHES);
+}
+
+TEST(error_log, is_bounded) {
+	error_list.clear();
+
+	for (uint32_t i = 0; i < ERROR_LOG_CAPACITY * 2; i++) {
+		push_error(error_detail(__FILE__, "", __LINE__, severity::DEBUG, "message"));
+	}
+
+	EXPECT_EQ(error_list.size(), ERROR_LOG_CAPACITY);
+
+	consume_errors();
+
+	EXPECT_TRUE(error_list.empty());
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "archetype_ecs.h"
+
+#include <sstream>
+#include <string>
+
+using namespace Vivium::ECS;
+
+namespace {
+	struct position_t {
+		float x, y;
+	};
+
+	struct velocity_t {
+		float x, y;
+	};
+}
+
+TEST(profiling, counts_structural_changes_and_queries) {
+	profiling::clear();
+
+	registry_t registry;
+	registry.register_component<position_t>();
+	registry.register_component<velocity_t>();
+
+	for (int i = 0; i < 100; i++) {
+		entity_value_t entity = registry.get_entity();
+
+		registry.push_component<position_t>(entity, position_t{ 0.0f, 0.0f });
+		registry.push_component<velocity_t>(entity, velocity_t{ 1.0f, 1.0f });
+	}
+
+	for (auto it = registry.begin<position_t, velocity_t>(); it != registry.end<position_t, velocity_t>(); ++it) {
+		auto [position, velocity] = *it;
+
+		position.x += velocity.x;
+	}
+
+	const profiling::frame_counters_t& frame = profiling::current_frame();
+
+	EXPECT_EQ(frame.counts[profiling::ARCHETYPE_CREATIONS], 2);
+	// Position column moved for every entity
+	EXPECT_EQ(frame.counts[profiling::ROW_MOVES], 100);
+	EXPECT_GT(frame.counts[profiling::COLUMN_REALLOCATIONS], 0);
+	EXPECT_GE(frame.counts[profiling::SPARSE_LOOKUPS], 200);
+	EXPECT_EQ(frame.counts[profiling::QUERIES], 1);
+
+	profiling::begin_frame();
+
+	EXPECT_EQ(profiling::last_frame().counts[profiling::QUERIES], 1);
+	EXPECT_EQ(profiling::current_frame().counts[profiling::QUERIES], 0);
+
+	std::stringstream trace;
+	ASSERT_TRUE(profiling::write_chrome_trace(trace));
+
+	std::string json = trace.str();
+
+	EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+	EXPECT_NE(json.find("\"cat\":\"queries\""), std::string::npos);
+	EXPECT_NE(json.find("\"ph\":\"C\""), std::string::npos);
+
+	profiling::clear();
+}
+
+TEST(profiling, counts_empty_and_interrupted_queries) {
+	profiling::clear();
+
+	registry_t registry;
+	registry.register_component<position_t>();
+	registry.register_component<velocity_t>();
+
+	for (auto it = registry.begin<position_t, velocity_t>(); it != registry.end<position_t, velocity_t>(); ++it) {}
+
+	EXPECT_EQ(profiling::current_frame().counts[profiling::QUERIES], 1);
+
+	for (int i = 0; i < 10; i++) {
+		registry.push_component<position_t>(registry.get_entity(), position_t{ 0.0f, 0.0f });
+	}
+
+	for (auto it = registry.begin<position_t>(); it != registry.end<position_t>(); ++it) {
+		break;
+	}
+
+	EXPECT_EQ(profiling::current_frame().counts[profiling::QUERIES], 2);
+
+	profiling::clear();
+}
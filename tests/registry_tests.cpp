@@ -0,0 +1,963 @@
+#include <gtest/gtest.h>
+
+#include "archetype_ecs.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Vivium::ECS;
+
+namespace {
+	struct position_t {
+		float x, y;
+	};
+
+	struct name_t {
+		std::string value;
+	};
+
+	// Counts copies, so tests can check components are constructed in place
+	struct counted_t {
+		static inline int copies = 0;
+
+		std::string value;
+
+		counted_t(const char* string, int repeat) : value() {
+			for (int i = 0; i < repeat; i++) value += string;
+		}
+
+		counted_t(const counted_t& other) : value(other.value) { ++copies; }
+		counted_t(counted_t&& other) noexcept = default;
+	};
+
+	// Holds only pointers to its heap buffer, so can be moved bytewise
+	struct inventory_t {
+		std::vector<int> items;
+	};
+}
+
+template <>
+struct Vivium::ECS::is_trivially_relocatable<inventory_t> : std::true_type {};
+
+namespace {
+	struct burning_t {
+		float damage;
+	};
+}
+
+template <>
+struct Vivium::ECS::component_storage_policy<burning_t>
+	: std::integral_constant<storage_policy, storage_policy::SPARSE> {};
+
+namespace {
+	struct registry_test : ::testing::Test {
+		registry_t registry;
+
+		registry_test() {
+			registry.register_component<int>();
+			registry.register_component<position_t>();
+			registry.register_component<name_t>();
+		}
+	};
+}
+
+TEST(entity, id_and_version_round_trip) {
+	entity_value_t value = entity_t::set_version(entity_t::set_id(0, MAX_ENTITY_ID - 1), 3);
+
+	EXPECT_EQ(entity_t::id(value), MAX_ENTITY_ID - 1);
+	EXPECT_EQ(entity_t::version(value), 3);
+
+	value = entity_t::set_id(value, 7);
+
+	EXPECT_EQ(entity_t::id(value), 7);
+	EXPECT_EQ(entity_t::version(value), 3);
+}
+
+TEST_F(registry_test, push_and_get_components) {
+	entity_value_t entity = registry.get_entity();
+
+	registry.push_components<int, position_t>(entity, 5, position_t{ 1.0f, 2.0f });
+
+	EXPECT_EQ(registry.get_component<int>(entity), 5);
+	EXPECT_EQ(registry.get_component<position_t>(entity).y, 2.0f);
+
+	registry.push_component<name_t>(entity, name_t{ "entity" });
+
+	EXPECT_EQ(registry.get_component<int>(entity), 5);
+	EXPECT_EQ(registry.get_component<name_t>(entity).value, "entity");
+}
+
+TEST_F(registry_test, push_components_replaces_components_already_present) {
+	entity_value_t entity = registry.get_entity();
+	registry.push_component<int>(entity, 3);
+
+	registry.push_components<int, position_t>(entity, 4, position_t{ 1.0f, 2.0f });
+
+	EXPECT_EQ(registry.get_component<int>(entity), 4);
+	EXPECT_EQ(registry.get_component<position_t>(entity).x, 1.0f);
+
+	// Columns of the archetype stayed the same length
+	entity_value_t other = registry.get_entity();
+	registry.push_components<int, position_t>(other, 9, position_t{ 5.0f, 6.0f });
+
+	EXPECT_EQ(registry.get_component<int>(other), 9);
+	EXPECT_EQ(registry.get_component<position_t>(other).x, 5.0f);
+
+	// Every component present, so the entity stays where it is
+	registry.push_components<int, position_t>(entity, 7, position_t{ 8.0f, 8.0f });
+
+	EXPECT_EQ(registry.get_component<int>(entity), 7);
+	EXPECT_EQ(registry.get_component<position_t>(entity).y, 8.0f);
+	EXPECT_EQ(registry.get_component<int>(other), 9);
+}
+
+TEST_F(registry_test, iteration_visits_every_entity) {
+	for (int i = 0; i < 100; i++) {
+		registry.push_components<int, position_t>(registry.get_entity(), i, position_t{ 0.0f, 0.0f });
+	}
+
+	int sum = 0;
+
+	for (auto it = registry.begin<int, position_t>(); it != registry.end<int, position_t>(); ++it) {
+		auto [value, position] = *it;
+
+		sum += value;
+	}
+
+	EXPECT_EQ(sum, 99 * 100 / 2);
+}
+
+TEST_F(registry_test, moving_entity_keeps_other_rows_valid) {
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 10; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_component<int>(entities.back(), i);
+	}
+
+	// Moving the first entity out swaps the last entity into its row
+	registry.push_component<name_t>(entities[0], name_t{ "moved" });
+	registry.remove_component<int>(entities[3]);
+	registry.free_entity(entities[5]);
+
+	for (int i = 0; i < 10; i++) {
+		if (i == 3 || i == 5) continue;
+
+		EXPECT_EQ(registry.get_component<int>(entities[i]), i);
+	}
+
+	EXPECT_EQ(registry.get_component<name_t>(entities[0]).value, "moved");
+}
+
+TEST_F(registry_test, removing_last_component_clears_entity) {
+	entity_value_t a = registry.get_entity();
+	entity_value_t b = registry.get_entity();
+
+	registry.push_component<int>(a, 1);
+	registry.push_component<int>(b, 2);
+
+	registry.remove_component<int>(a);
+
+	EXPECT_EQ(registry.get_component<int>(b), 2);
+
+	registry.push_component<int>(a, 3);
+
+	EXPECT_EQ(registry.get_component<int>(a), 3);
+	EXPECT_EQ(registry.get_component<int>(b), 2);
+}
+
+TEST_F(registry_test, non_trivial_components_survive_growth) {
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 64; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_components<int, name_t>(entities.back(), i, name_t{ std::string(32, 'a' + i % 26) });
+	}
+
+	registry.remove_component<int>(entities[0]);
+
+	for (int i = 0; i < 64; i++) {
+		EXPECT_EQ(registry.get_component<name_t>(entities[i]).value, std::string(32, 'a' + i % 26));
+	}
+}
+
+TEST_F(registry_test, clone_is_independent) {
+	entity_value_t entity = registry.get_entity();
+	registry.push_components<int, name_t>(entity, 1, name_t{ "original" });
+
+	std::unique_ptr<registry_t> copy = registry.clone();
+
+	copy->get_component<int>(entity) = 2;
+	copy->get_component<name_t>(entity).value = "copy";
+
+	EXPECT_EQ(registry.get_component<int>(entity), 1);
+	EXPECT_EQ(registry.get_component<name_t>(entity).value, "original");
+
+	// Structural changes work on the copy
+	copy->remove_component<name_t>(entity);
+	EXPECT_EQ(copy->get_component<int>(entity), 2);
+}
+
+TEST_F(registry_test, prefab_instances_copy_components) {
+	entity_value_t prefab = registry.create_prefab<int, name_t>(7, name_t{ "npc" });
+
+	std::vector<entity_value_t> instances = registry.instantiate(prefab, 100);
+
+	ASSERT_EQ(instances.size(), 100);
+
+	for (entity_value_t instance : instances) {
+		EXPECT_EQ(registry.get_component<int>(instance), 7);
+		EXPECT_EQ(registry.get_component<name_t>(instance).value, "npc");
+	}
+
+	// Prefab itself isn't iterated
+	uint32_t count = 0;
+
+	for (auto it = registry.begin<int, name_t>(); it != registry.end<int, name_t>(); ++it) {
+		++count;
+	}
+
+	EXPECT_EQ(count, 100);
+}
+
+TEST_F(registry_test, prefab_components_can_be_replaced_but_not_added_or_removed) {
+	entity_value_t prefab = registry.create_prefab<int>(7);
+
+	registry.push_component<int>(prefab, 9);
+	registry.push_component<position_t>(prefab, position_t{ 1.0f, 1.0f });
+	registry.push_components<position_t, name_t>(prefab, position_t{ 1.0f, 1.0f }, name_t{ "npc" });
+	registry.add_component_to<position_t>(&prefab, 1, position_t{ 1.0f, 1.0f });
+	registry.remove_component<int>(prefab);
+
+	EXPECT_EQ(registry.get_component<int>(prefab), 9);
+
+	std::vector<entity_value_t> instances = registry.instantiate(prefab, 3);
+
+	ASSERT_EQ(instances.size(), 3);
+
+	for (entity_value_t instance : instances) {
+		EXPECT_EQ(registry.get_component<int>(instance), 9);
+	}
+
+	// Instances have only the original components
+	uint32_t count = 0;
+
+	for (auto it = registry.begin<int, position_t>(); it != registry.end<int, position_t>(); ++it) {
+		++count;
+	}
+
+	EXPECT_EQ(count, 0);
+}
+
+TEST_F(registry_test, bulk_add_moves_entities_between_archetypes) {
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 100; i++) {
+		entities.push_back(registry.get_entity());
+
+		if (i % 2 == 0)
+			registry.push_component<int>(entities.back(), i);
+		else
+			registry.push_components<int, name_t>(entities.back(), i, name_t{ std::to_string(i) });
+	}
+
+	// Every third entity, scattered rows across both archetypes, with a duplicate
+	std::vector<entity_value_t> targets;
+
+	for (int i = 0; i < 100; i += 3) {
+		targets.push_back(entities[i]);
+	}
+
+	targets.push_back(entities[0]);
+
+	registry.add_component_to(targets, position_t{ 1.0f, 2.0f });
+
+	for (int i = 0; i < 100; i++) {
+		EXPECT_EQ(registry.get_component<int>(entities[i]), i);
+
+		if (i % 2 == 1) {
+			EXPECT_EQ(registry.get_component<name_t>(entities[i]).value, std::to_string(i));
+		}
+
+		if (i % 3 == 0) {
+			EXPECT_EQ(registry.get_component<position_t>(entities[i]).y, 2.0f);
+		}
+	}
+
+	// Entities that already have it are replaced
+	registry.add_component_to(targets, position_t{ 3.0f, 4.0f });
+
+	EXPECT_EQ(registry.get_component<position_t>(entities[99]).y, 4.0f);
+}
+
+TEST_F(registry_test, bulk_add_to_query) {
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 50; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_components<int, name_t>(entities.back(), i, name_t{ std::to_string(i) });
+	}
+
+	registry.add_component_to_query<int, name_t>(position_t{ 5.0f, 6.0f });
+
+	int count = 0;
+
+	for (auto it = registry.begin<int, position_t, name_t>(); it != registry.end<int, position_t, name_t>(); ++it) {
+		auto [value, position, name] = *it;
+
+		EXPECT_EQ(name.value, std::to_string(value));
+		EXPECT_EQ(position.x, 5.0f);
+
+		++count;
+	}
+
+	EXPECT_EQ(count, 50);
+	EXPECT_EQ(registry.get_component<name_t>(entities[49]).value, "49");
+}
+
+TEST_F(registry_test, bulk_add_to_query_filters_by_sparse_components) {
+	registry.register_component<burning_t>();
+
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 20; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_components<int, name_t>(entities.back(), i, name_t{ std::to_string(i) });
+
+		if (i % 2 == 0)
+			registry.push_component<burning_t>(entities.back(), burning_t{ 1.0f });
+	}
+
+	registry.add_component_to_query<int, name_t, burning_t>(position_t{ 5.0f, 6.0f });
+
+	int count = 0;
+
+	for (auto it = registry.begin<int, position_t, name_t>(); it != registry.end<int, position_t, name_t>(); ++it) {
+		auto [value, position, name] = *it;
+
+		EXPECT_EQ(value % 2, 0);
+		EXPECT_EQ(name.value, std::to_string(value));
+
+		++count;
+	}
+
+	EXPECT_EQ(count, 10);
+	EXPECT_EQ(registry.get_component<name_t>(entities[19]).value, "19");
+
+	// Sparse component added to the rows of the query that have it already
+	registry.add_component_to_query<int, position_t, name_t, burning_t>(burning_t{ 3.0f });
+
+	EXPECT_EQ(registry.get_component<burning_t>(entities[4]).damage, 3.0f);
+}
+
+TEST_F(registry_test, relocatable_components_survive_moves) {
+	registry.register_component<inventory_t>();
+
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 100; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_components<int, inventory_t>(entities.back(), i, inventory_t{ std::vector<int>(i + 1, i) });
+	}
+
+	// Moves rows between archetypes, and swap removes from both
+	for (int i = 0; i < 100; i += 2) {
+		registry.push_component<position_t>(entities[i], position_t{ 0.0f, 0.0f });
+	}
+
+	registry.free_entity(entities[1]);
+
+	for (int i = 2; i < 100; i++) {
+		const std::vector<int>& items = registry.get_component<inventory_t>(entities[i]).items;
+
+		EXPECT_EQ(items.size(), i + 1);
+		EXPECT_EQ(items.back(), i);
+	}
+}
+
+TEST_F(registry_test, emplace_and_move_in_components_are_not_copied) {
+	registry.register_component<counted_t>();
+	registry.register_component<std::unique_ptr<int>>();
+
+	counted_t::copies = 0;
+
+	entity_value_t a = registry.get_entity();
+	entity_value_t b = registry.get_entity();
+
+	registry.emplace_component<counted_t>(a, "ab", 3);
+	registry.push_component<std::unique_ptr<int>>(a, std::make_unique<int>(7));
+	registry.push_components<int, counted_t>(b, 1, counted_t("c", 2));
+
+	// Replacing an existing component constructs in place too
+	registry.emplace_component<counted_t>(b, "d", 1);
+
+	EXPECT_EQ(counted_t::copies, 0);
+	EXPECT_EQ(registry.get_component<counted_t>(a).value, "ababab");
+	EXPECT_EQ(*registry.get_component<std::unique_ptr<int>>(a), 7);
+	EXPECT_EQ(registry.get_component<counted_t>(b).value, "d");
+	EXPECT_EQ(registry.get_component<int>(b), 1);
+
+	// Lvalues are still copied
+	counted_t original("e", 1);
+	registry.push_component(registry.get_entity(), original);
+
+	EXPECT_EQ(counted_t::copies, 1);
+	EXPECT_EQ(original.value, "e");
+}
+
+TEST_F(registry_test, resources_are_stored_per_registry) {
+	struct time_step_t {
+		float seconds;
+	};
+
+	EXPECT_FALSE(registry.has_resource<time_step_t>());
+	EXPECT_EQ(registry.try_resource<time_step_t>(), nullptr);
+
+	registry.emplace_resource<time_step_t>(0.5f);
+	registry.emplace_resource<name_t>(name_t{ "world" });
+
+	registry.resource<time_step_t>().seconds *= 2.0f;
+
+	EXPECT_EQ(registry.resource<time_step_t>().seconds, 1.0f);
+	EXPECT_EQ(registry.resource<name_t>().value, "world");
+
+	std::unique_ptr<registry_t> copy = registry.clone();
+	copy->resource<name_t>().value = "copy";
+
+	EXPECT_EQ(registry.resource<name_t>().value, "world");
+	EXPECT_EQ(copy->resource<name_t>().value, "copy");
+
+	registry_t other;
+	EXPECT_FALSE(other.has_resource<name_t>());
+
+	registry.remove_resource<time_step_t>();
+	EXPECT_FALSE(registry.has_resource<time_step_t>());
+	EXPECT_TRUE(registry.has_resource<name_t>());
+}
+
+TEST_F(registry_test, tags_have_no_columns) {
+	struct enemy_t {};
+	struct selected_t {};
+
+	registry.register_component<enemy_t>();
+	registry.register_component<selected_t>();
+
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 10; i++) {
+		entities.push_back(registry.get_entity());
+
+		registry.push_components<int, enemy_t>(entities.back(), i, enemy_t{});
+	}
+
+	registry.push_component<selected_t>(entities[3], selected_t{});
+	registry.add_component_to<selected_t>(entities, selected_t{});
+
+	int sum = 0;
+	int visited = 0;
+
+	for (auto it = registry.begin<int, enemy_t, selected_t>(); it != registry.end<int, enemy_t, selected_t>(); ++it) {
+		auto [value, enemy, selected] = *it;
+
+		sum += value;
+		++visited;
+	}
+
+	EXPECT_EQ(visited, 10);
+	EXPECT_EQ(sum, 45);
+
+	registry.remove_component<selected_t>(entities[5]);
+	registry.remove_component<int>(entities[5]);
+
+	EXPECT_EQ(registry.get_component<int>(entities[6]), 6);
+
+	// Only tags left, so the entity's archetype has no columns at all
+	registry.get_component<enemy_t>(entities[5]);
+	registry.remove_component<enemy_t>(entities[5]);
+
+	std::unique_ptr<registry_t> copy = registry.clone();
+	EXPECT_EQ(copy->get_component<int>(entities[9]), 9);
+}
+
+TEST_F(registry_test, sparse_components_dont_move_entities) {
+	registry.register_component<burning_t>();
+
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 10; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_components<int, position_t>(entities.back(), i, position_t{ 0.0f, 0.0f });
+	}
+
+	for (int i = 0; i < 10; i += 2) {
+		registry.push_component<burning_t>(entities[i], burning_t{ 1.0f * i });
+	}
+
+	// Toggling doesn't change rows in the archetype
+	registry.remove_component<burning_t>(entities[4]);
+	registry.push_component<burning_t>(entities[4], burning_t{ 4.0f });
+	registry.remove_component<burning_t>(entities[0]);
+
+	EXPECT_EQ(registry.get_component<int>(entities[9]), 9);
+	EXPECT_EQ(registry.get_component<burning_t>(entities[8]).damage, 8.0f);
+
+	int sum = 0;
+	float damage = 0.0f;
+
+	for (auto it = registry.begin<int, position_t, burning_t>(); it != registry.end<int, position_t, burning_t>(); ++it) {
+		auto [value, position, burning] = *it;
+
+		sum += value;
+		damage += burning.damage;
+	}
+
+	EXPECT_EQ(sum, 2 + 4 + 6 + 8);
+	EXPECT_EQ(damage, 20.0f);
+
+	// Entities with only sparse components don't need an archetype
+	entity_value_t sparse_only = registry.get_entity();
+	registry.push_component<burning_t>(sparse_only, burning_t{ 3.0f });
+
+	std::unique_ptr<registry_t> copy = registry.clone();
+
+	registry.free_entity(entities[8]);
+	registry.free_entity(sparse_only);
+
+	EXPECT_EQ(registry.get_component<burning_t>(entities[6]).damage, 6.0f);
+	EXPECT_EQ(copy->get_component<burning_t>(entities[8]).damage, 8.0f);
+	EXPECT_EQ(copy->get_component<burning_t>(sparse_only).damage, 3.0f);
+}
+
+TEST_F(registry_test, mixed_push_moves_entity_once) {
+	registry.register_component<burning_t>();
+
+	entity_value_t entity = registry.get_entity();
+	registry.push_components<int, burning_t, position_t, name_t>(entity, 1, burning_t{ 2.0f }, position_t{ 3.0f, 4.0f }, name_t{ "mixed" });
+
+	EXPECT_EQ(registry.get_component<int>(entity), 1);
+	EXPECT_EQ(registry.get_component<burning_t>(entity).damage, 2.0f);
+	EXPECT_EQ(registry.get_component<position_t>(entity).y, 4.0f);
+	EXPECT_EQ(registry.get_component<name_t>(entity).value, "mixed");
+
+	// Only the final archetype was created, none on the way
+	EXPECT_EQ(registry.memory_report().archetypes.size(), 1);
+
+	// Sparse only pushes leave the entity without an archetype
+	entity_value_t sparse_only = registry.get_entity();
+	registry.push_components<burning_t>(sparse_only, burning_t{ 5.0f });
+
+	EXPECT_EQ(registry.get_component<burning_t>(sparse_only).damage, 5.0f);
+	EXPECT_EQ(registry.memory_report().archetypes.size(), 1);
+}
+
+TEST_F(registry_test, disabled_entities_are_skipped) {
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 200; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_component<int>(entities.back(), i);
+	}
+
+	int expected = 0;
+
+	for (int i = 0; i < 200; i++) {
+		if (i % 3 == 0 || (i >= 64 && i < 140))
+			registry.set_enabled(entities[i], false);
+		else
+			expected += i;
+	}
+
+	auto sum_enabled = [&]() {
+		int sum = 0;
+
+		for (auto it = registry.begin<int>(); it != registry.end<int>(); ++it) {
+			auto [value] = *it;
+			sum += value;
+		}
+
+		return sum;
+	};
+
+	EXPECT_EQ(sum_enabled(), expected);
+
+	// Disabled state follows the entity to its new archetype, and rows swapped
+	// into its old place keep theirs
+	registry.push_component<position_t>(entities[3], position_t{ 0.0f, 0.0f });
+	registry.remove_component<position_t>(entities[3]);
+	registry.free_entity(entities[0]);
+
+	EXPECT_FALSE(registry.is_enabled(entities[3]));
+	EXPECT_FALSE(registry.is_enabled(entities[198]));
+	EXPECT_TRUE(registry.is_enabled(entities[199]));
+	EXPECT_EQ(sum_enabled(), expected);
+
+	registry.set_enabled(entities[100], true);
+	EXPECT_EQ(sum_enabled(), expected + 100);
+
+	// Bulk moves carry the bits too
+	registry.add_component_to<position_t>(entities.data() + 1, 199, position_t{ 0.0f, 0.0f });
+
+	int sum = 0;
+
+	for (auto it = registry.begin<int, position_t>(); it != registry.end<int, position_t>(); ++it) {
+		sum += it.get<int>();
+	}
+
+	EXPECT_EQ(sum, expected + 100);
+}
+
+TEST_F(registry_test, relations_are_indexed_both_ways) {
+	struct child_of_t {};
+	struct targets_t {};
+
+	entity_value_t parent = registry.get_entity();
+	entity_value_t other_parent = registry.get_entity();
+
+	std::vector<entity_value_t> children;
+
+	for (int i = 0; i < 5; i++) {
+		children.push_back(registry.get_entity());
+		registry.push_component<int>(children.back(), i);
+		registry.add_relation<child_of_t>(children.back(), i < 3 ? parent : other_parent);
+	}
+
+	registry.add_relation<targets_t>(children[0], children[4]);
+
+	EXPECT_EQ(registry.sources_of<child_of_t>(parent).size(), 3);
+	EXPECT_EQ(registry.sources_of<child_of_t>(other_parent).size(), 2);
+	EXPECT_EQ(registry.targets_of<child_of_t>(children[4]), std::vector<entity_value_t>({ other_parent }));
+	EXPECT_TRUE(registry.has_relation<targets_t>(children[0], children[4]));
+	EXPECT_FALSE(registry.has_relation<targets_t>(children[4], children[0]));
+
+	registry.remove_relation<child_of_t>(children[1], parent);
+	EXPECT_EQ(registry.sources_of<child_of_t>(parent).size(), 2);
+
+	// Freeing an entity removes it from pairs on both sides
+	registry.free_entity(children[4]);
+
+	EXPECT_TRUE(registry.targets_of<targets_t>(children[0]).empty());
+	EXPECT_EQ(registry.sources_of<child_of_t>(other_parent), std::vector<entity_value_t>({ children[3] }));
+
+	registry.free_entity(parent);
+
+	EXPECT_TRUE(registry.targets_of<child_of_t>(children[0]).empty());
+	EXPECT_TRUE(registry.sources_of<child_of_t>(parent).empty());
+}
+
+TEST_F(registry_test, sorted_hierarchy_visits_parents_first) {
+	struct child_of_t {};
+
+	// Children are created before their parents, so rows start out of order
+	std::vector<entity_value_t> nodes;
+
+	for (int i = 0; i < 100; i++) {
+		nodes.push_back(registry.get_entity());
+		registry.push_components<int, position_t>(nodes.back(), i, position_t{ 1.0f, 0.0f });
+	}
+
+	for (int i = 0; i < 99; i++) {
+		registry.set_parent<child_of_t>(nodes[i], nodes[i + 1 + (i * 7) % (99 - i)]);
+	}
+
+	// Reparenting replaces the old parent
+	registry.set_parent<child_of_t>(nodes[0], nodes[99]);
+
+	EXPECT_EQ(registry.parent_of<child_of_t>(nodes[0]), nodes[99]);
+	EXPECT_EQ(registry.parent_of<child_of_t>(nodes[99]), ENTITY_NULL);
+	EXPECT_EQ(registry.sources_of<child_of_t>(nodes[99]).back(), nodes[0]);
+
+	registry.sort_hierarchy<child_of_t>();
+
+	// World x is the depth of each node, in one forward pass
+	for (auto it = registry.begin<int, position_t>(); it != registry.end<int, position_t>(); ++it) {
+		auto [index, position] = *it;
+
+		entity_value_t parent = registry.parent_of<child_of_t>(nodes[index]);
+
+		if (parent != ENTITY_NULL)
+			position.x = registry.get_component<position_t>(parent).x + 1.0f;
+		else
+			position.x = 0.0f;
+	}
+
+	for (int i = 0; i < 100; i++) {
+		float depth = 0.0f;
+
+		for (entity_value_t node = nodes[i]; registry.parent_of<child_of_t>(node) != ENTITY_NULL;
+			node = registry.parent_of<child_of_t>(node))
+		{
+			depth += 1.0f;
+		}
+
+		EXPECT_EQ(registry.get_component<position_t>(nodes[i]).x, depth);
+		EXPECT_EQ(registry.get_component<int>(nodes[i]), i);
+	}
+}
+
+TEST_F(registry_test, sort_orders_rows_of_every_archetype) {
+	std::vector<entity_value_t> entities;
+
+	// Keys are a permutation of 0..99, split between two archetypes holding int
+	for (int i = 0; i < 100; i++) {
+		entities.push_back(registry.get_entity());
+
+		if (i % 2 == 0)
+			registry.push_components<int, position_t>(entities.back(), (i * 37) % 100, position_t{ float(i), 0.0f });
+		else
+			registry.push_components<int, name_t>(entities.back(), (i * 37) % 100, name_t{ std::to_string(i) });
+	}
+
+	registry.set_enabled(entities[10], false);
+
+	auto keys = [&]<typename T>() {
+		std::vector<int> values;
+
+		for (auto it = registry.begin<int, T>(); it != registry.end<int, T>(); ++it) {
+			auto [key, other] = *it;
+
+			values.push_back(key);
+		}
+
+		return values;
+	};
+
+	registry.sort<int>(std::greater<int>());
+
+	std::vector<int> positions = keys.operator()<position_t>();
+	std::vector<int> names = keys.operator()<name_t>();
+
+	EXPECT_EQ(positions.size(), 49);
+	EXPECT_EQ(names.size(), 50);
+	EXPECT_TRUE(std::is_sorted(positions.begin(), positions.end(), std::greater<int>()));
+	EXPECT_TRUE(std::is_sorted(names.begin(), names.end(), std::greater<int>()));
+
+	// Entities still find their own components, and stay disabled
+	for (int i = 0; i < 100; i++) {
+		EXPECT_EQ(registry.get_component<int>(entities[i]), (i * 37) % 100);
+
+		if (i % 2 == 0)
+			EXPECT_EQ(registry.get_component<position_t>(entities[i]).x, float(i));
+		else
+			EXPECT_EQ(registry.get_component<name_t>(entities[i]).value, std::to_string(i));
+	}
+
+	EXPECT_FALSE(registry.is_enabled(entities[10]));
+
+	// Nudging one key leaves the rows nearly sorted
+	registry.get_component<int>(entities[1]) = -1;
+	registry.sort<int>(std::greater<int>());
+
+	names = keys.operator()<name_t>();
+
+	EXPECT_TRUE(std::is_sorted(names.begin(), names.end(), std::greater<int>()));
+	EXPECT_EQ(names.back(), -1);
+	EXPECT_EQ(registry.get_component<name_t>(entities[1]).value, "1");
+}
+
+TEST_F(registry_test, compact_removes_empty_archetypes) {
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 1000; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_component<int>(entities.back(), i);
+	}
+
+	// Pass every entity through a transient archetype, then shrink back to a few
+	for (entity_value_t entity : entities) {
+		registry.push_component<position_t>(entity, position_t{ 1.0f, 2.0f });
+	}
+
+	for (entity_value_t entity : entities) {
+		registry.remove_component<position_t>(entity);
+	}
+
+	for (int i = 10; i < 1000; i++) {
+		registry.free_entity(entities[i]);
+	}
+
+	entities.resize(10);
+
+	EXPECT_GT(registry.compact(), 0);
+	EXPECT_EQ(registry.compact(), 0);
+
+	// Deleted archetype iterates as empty
+	auto begin = registry.begin<int, position_t>();
+	auto end = registry.end<int, position_t>();
+
+	EXPECT_TRUE(begin == end);
+
+	for (int i = 0; i < 10; i++) {
+		EXPECT_EQ(registry.get_component<int>(entities[i]), i);
+	}
+
+	// Graph edges to the deleted archetype are rebuilt when used again
+	registry.push_component<position_t>(entities[3], position_t{ 3.0f, 4.0f });
+
+	EXPECT_EQ(registry.get_component<position_t>(entities[3]).y, 4.0f);
+	EXPECT_EQ(registry.get_component<int>(entities[3]), 3);
+
+	int count = 0;
+
+	for (auto it = registry.begin<int, position_t>(); it != registry.end<int, position_t>(); ++it) {
+		++count;
+	}
+
+	EXPECT_EQ(count, 1);
+}
+
+TEST_F(registry_test, memory_report_accounts_for_columns_and_pools) {
+	registry.register_component<burning_t>();
+
+	std::vector<entity_value_t> entities;
+
+	for (int i = 0; i < 100; i++) {
+		entities.push_back(registry.get_entity());
+		registry.push_component<int>(entities.back(), i);
+
+		if (i < 50)
+			registry.push_component<position_t>(entities.back(), position_t{ 0.0f, 0.0f });
+
+		if (i < 10)
+			registry.push_component<burning_t>(entities.back(), burning_t{ 1.0f });
+	}
+
+	for (int i = 50; i < 55; i++) {
+		registry.free_entity(entities[i]);
+	}
+
+	memory_report_t report = registry.memory_report();
+
+	uint32_t rows = 0;
+
+	for (const archetype_memory_t& archetype : report.archetypes) {
+		rows += archetype.rows;
+
+		EXPECT_GE(archetype.overhead_bytes, sizeof(archetype_t));
+
+		for (const column_memory_t& column : archetype.columns) {
+			EXPECT_EQ(column.count, archetype.rows);
+			EXPECT_GE(column.reserved_bytes, column.live_bytes);
+		}
+	}
+
+	EXPECT_EQ(rows, 95);
+
+	// Totals per component, found by what they hold since ids aren't exposed
+	auto total_with = [&](uint32_t count, size_t live_bytes) {
+		return std::count_if(report.components.begin(), report.components.end(), [&](const column_memory_t& total) {
+			return total.count == count && total.live_bytes == live_bytes;
+		});
+	};
+
+	EXPECT_EQ(total_with(95, 95 * sizeof(int)), 1);
+	EXPECT_EQ(total_with(50, 50 * sizeof(position_t)), 1);
+	EXPECT_EQ(total_with(10, 10 * sizeof(burning_t)), 1);
+
+	ASSERT_EQ(report.sparse_pools.size(), 1);
+	EXPECT_EQ(report.sparse_pools[0].column.count, 10);
+	EXPECT_EQ(report.sparse_pools[0].index_pages, 1);
+
+	EXPECT_EQ(report.entity_ids.created, 100);
+	EXPECT_EQ(report.entity_ids.available, 5);
+	EXPECT_GT(report.entity_lookup_pages, 0);
+
+	// Compacting leaves no capacity unused
+	size_t total = report.total_bytes();
+	size_t reclaimed = registry.compact();
+
+	registry.memory_report(report);
+
+	EXPECT_EQ(report.total_bytes(), total - reclaimed);
+
+	for (const archetype_memory_t& archetype : report.archetypes) {
+		for (const column_memory_t& column : archetype.columns) {
+			EXPECT_EQ(column.unused_bytes(), 0);
+		}
+	}
+}
+
+TEST_F(registry_test, merge_and_transfer_between_registries) {
+	struct linked_t {};
+
+	registry.register_component<burning_t>();
+
+	// Loaded cell registers components in another order, so ids differ
+	registry_t cell;
+	cell.register_component<name_t>();
+	cell.register_component<burning_t>();
+	cell.register_component<position_t>();
+	cell.register_component<int>();
+
+	entity_value_t existing = registry.get_entity();
+	registry.push_components<int, position_t>(existing, -1, position_t{ 0.0f, 0.0f });
+
+	std::vector<entity_value_t> built;
+
+	for (int i = 0; i < 100; i++) {
+		built.push_back(cell.get_entity());
+		cell.push_components<int, position_t>(built.back(), i, position_t{ float(i), 1.0f });
+
+		if (i % 10 == 0)
+			cell.push_component<name_t>(built.back(), name_t{ std::to_string(i) });
+
+		if (i < 5)
+			cell.push_component<burning_t>(built.back(), burning_t{ float(i) });
+	}
+
+	cell.set_enabled(built[1], false);
+	cell.add_relation<linked_t>(built[2], built[3]);
+
+	entity_value_t prefab = cell.create_prefab<int, position_t>(7, position_t{ 7.0f, 7.0f });
+
+	std::vector<entity_value_t> merged = registry.merge_from(cell);
+
+	ASSERT_EQ(merged.size(), 101);
+	EXPECT_EQ(merged[prefab], ENTITY_NULL);
+
+	for (int i = 0; i < 100; i++) {
+		entity_value_t entity = merged[built[i]];
+
+		EXPECT_EQ(registry.get_component<int>(entity), i);
+		EXPECT_EQ(registry.get_component<position_t>(entity).x, float(i));
+
+		if (i % 10 == 0) {
+			EXPECT_EQ(registry.get_component<name_t>(entity).value, std::to_string(i));
+		}
+
+		if (i < 5) {
+			EXPECT_EQ(registry.get_component<burning_t>(entity).damage, float(i));
+		}
+	}
+
+	EXPECT_EQ(registry.get_component<int>(existing), -1);
+	EXPECT_FALSE(registry.is_enabled(merged[built[1]]));
+	EXPECT_TRUE(registry.has_relation<linked_t>(merged[built[2]], merged[built[3]]));
+
+	// Cell is left with only its prefab
+	EXPECT_FALSE(cell.has_relation<linked_t>(built[2], built[3]));
+	EXPECT_EQ(cell.get_component<int>(prefab), 7);
+	auto begin = cell.begin<int, position_t>();
+	auto end = cell.end<int, position_t>();
+
+	EXPECT_TRUE(begin == end);
+
+	// Move one entity back on its own
+	entity_value_t returned = registry.transfer(merged[built[0]], cell);
+
+	EXPECT_EQ(cell.get_component<int>(returned), 0);
+	EXPECT_EQ(cell.get_component<name_t>(returned).value, "0");
+	EXPECT_EQ(cell.get_component<burning_t>(returned).damage, 0.0f);
+
+	int remaining = 0;
+
+	for (auto it = registry.begin<int, position_t, name_t>(); it != registry.end<int, position_t, name_t>(); ++it) {
+		auto [value, position, name] = *it;
+
+		EXPECT_EQ(name.value, std::to_string(value));
+		++remaining;
+	}
+
+	EXPECT_EQ(remaining, 9);
+}
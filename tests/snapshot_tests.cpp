@@ -0,0 +1,366 @@
+#include <gtest/gtest.h>
+
+#include "archetype_ecs.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Vivium::ECS;
+
+namespace {
+	struct velocity_t {
+		float x, y;
+	};
+
+	struct tag_t {
+		std::string value;
+	};
+}
+
+template <>
+struct Vivium::ECS::component_serializer<tag_t> {
+	static void save(std::ostream& stream, const tag_t& tag) {
+		write_raw(stream, static_cast<uint32_t>(tag.value.size()));
+		stream.write(tag.value.data(), tag.value.size());
+	}
+
+	static tag_t load(std::istream& stream) {
+		uint32_t length = 0;
+		read_raw(stream, length);
+
+		tag_t tag;
+		tag.value.resize(length);
+		stream.read(tag.value.data(), length);
+
+		return tag;
+	}
+};
+
+namespace {
+	struct burning_t {
+		float damage;
+	};
+}
+
+template <>
+struct Vivium::ECS::component_storage_policy<burning_t>
+	: std::integral_constant<storage_policy, storage_policy::SPARSE> {};
+
+namespace {
+	void register_components(registry_t& registry) {
+		registry.register_component<int>();
+		registry.register_component<velocity_t>();
+		registry.register_component<tag_t>();
+		registry.register_component<burning_t>();
+	}
+
+	std::vector<entity_value_t> populate(registry_t& registry, int count) {
+		std::vector<entity_value_t> entities;
+
+		for (int i = 0; i < count; i++) {
+			entities.push_back(registry.get_entity());
+			registry.push_components<int, velocity_t>(entities.back(), i, velocity_t{ 0.5f * i, 0.0f });
+		}
+
+		return entities;
+	}
+}
+
+TEST(snapshot, save_and_load_round_trip) {
+	std::stringstream stream;
+	std::vector<entity_value_t> entities;
+	entity_value_t tagged;
+
+	{
+		registry_t registry;
+		register_components(registry);
+
+		entities = populate(registry, 1000);
+
+		tagged = registry.get_entity();
+		registry.push_components<int, tag_t>(tagged, -1, tag_t{ "tagged" });
+		registry.push_component<burning_t>(entities[20], burning_t{ 2.0f });
+		registry.set_enabled(entities[30], false);
+
+		registry.free_entity(entities[10]);
+
+		ASSERT_TRUE(registry.save(stream));
+	}
+
+	registry_t loaded;
+	register_components(loaded);
+
+	ASSERT_TRUE(loaded.load(stream));
+
+	EXPECT_EQ(loaded.get_component<int>(entities[999]), 999);
+	EXPECT_EQ(loaded.get_component<velocity_t>(entities[4]).x, 2.0f);
+	EXPECT_EQ(loaded.get_component<tag_t>(tagged).value, "tagged");
+	EXPECT_EQ(loaded.get_component<burning_t>(entities[20]).damage, 2.0f);
+	EXPECT_FALSE(loaded.is_enabled(entities[30]));
+	EXPECT_TRUE(loaded.is_enabled(entities[31]));
+
+	// Freed id is recycled first, as it would have been in the saved registry
+	EXPECT_EQ(loaded.get_entity(), entities[10]);
+}
+
+TEST(snapshot, load_discards_relations) {
+	struct linked_t {};
+
+	std::stringstream stream;
+
+	registry_t registry;
+	register_components(registry);
+
+	std::vector<entity_value_t> entities = populate(registry, 2);
+
+	ASSERT_TRUE(registry.save(stream));
+
+	registry.add_relation<linked_t>(entities[0], entities[1]);
+
+	ASSERT_TRUE(registry.load(stream));
+
+	EXPECT_FALSE(registry.has_relation<linked_t>(entities[0], entities[1]));
+}
+
+TEST(snapshot, load_rejects_other_limits) {
+	std::string bytes;
+
+	{
+		registry_t registry;
+		register_components(registry);
+		populate(registry, 4);
+
+		std::stringstream stream;
+		ASSERT_TRUE(registry.save(stream));
+
+		bytes = stream.str();
+	}
+
+	// Limits follow the magic and version
+	uint32_t max_components = MAX_COMPONENTS * 2;
+	std::memcpy(bytes.data() + 2 * sizeof(uint32_t), &max_components, sizeof(max_components));
+
+	registry_t registry;
+	register_components(registry);
+
+	std::stringstream stream(bytes);
+
+	EXPECT_FALSE(registry.load(stream));
+}
+
+TEST(snapshot, truncated_load_leaves_registry_untouched) {
+	std::string bytes;
+
+	{
+		registry_t registry;
+		register_components(registry);
+
+		std::vector<entity_value_t> entities = populate(registry, 1000);
+		registry.push_component<burning_t>(entities[20], burning_t{ 2.0f });
+
+		std::stringstream stream;
+		ASSERT_TRUE(registry.save(stream));
+
+		bytes = stream.str();
+	}
+
+	registry_t registry;
+	register_components(registry);
+
+	std::vector<entity_value_t> entities = populate(registry, 10);
+	registry.push_component<burning_t>(entities[3], burning_t{ 1.0f });
+
+	// Cut the snapshot at points through every section, down to a single missing byte
+	for (size_t length = 0; length < bytes.size(); length += length + 64 < bytes.size() ? 64 : 1) {
+		std::stringstream stream(bytes.substr(0, length));
+
+		ASSERT_FALSE(registry.load(stream)) << "Loaded snapshot truncated to " << length << " bytes";
+	}
+
+	for (int i = 0; i < 10; i++) {
+		EXPECT_EQ(registry.get_component<int>(entities[i]), i);
+	}
+
+	EXPECT_EQ(registry.get_component<burning_t>(entities[3]).damage, 1.0f);
+
+	// Entity ids continue from the original contents, not the partially read snapshot
+	EXPECT_EQ(registry.get_entity(), 10);
+}
+
+TEST(snapshot, mapped_load_is_copy_on_write) {
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "archetype_ecs_mapped_test.bin";
+	std::vector<entity_value_t> entities;
+
+	{
+		registry_t registry;
+		register_components(registry);
+
+		entities = populate(registry, 1000);
+
+		std::ofstream file(path, std::ios::binary);
+		ASSERT_TRUE(registry.save(file));
+	}
+
+	{
+		registry_t loaded;
+		register_components(loaded);
+
+		ASSERT_TRUE(loaded.load_mapped(path.string().c_str()));
+
+		EXPECT_EQ(loaded.get_component<int>(entities[500]), 500);
+
+		loaded.get_component<int>(entities[500]) = -500;
+
+		// Growing a mapped column copies it
+		populate(loaded, 10);
+
+		EXPECT_EQ(loaded.get_component<int>(entities[500]), -500);
+
+		// File was never written to
+		registry_t reloaded;
+		register_components(reloaded);
+
+		ASSERT_TRUE(reloaded.load_mapped(path.string().c_str()));
+		EXPECT_EQ(reloaded.get_component<int>(entities[500]), 500);
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST(snapshot, rollback_restores_checkpoints) {
+	registry_t registry;
+	register_components(registry);
+
+	std::vector<entity_value_t> entities = populate(registry, 1000);
+
+	rollback_buffer_t history(registry, 4);
+
+	ASSERT_TRUE(history.checkpoint());
+
+	registry.get_component<int>(entities[1]) = 100;
+	registry.remove_component<velocity_t>(entities[2]);
+	registry.set_enabled(entities[5], false);
+
+	ASSERT_TRUE(history.checkpoint());
+
+	entity_value_t spawned = registry.get_entity();
+	registry.push_component<int>(spawned, 5);
+
+	ASSERT_TRUE(history.checkpoint());
+	EXPECT_EQ(history.size(), 3);
+
+	// Delta only holds the chunks that changed
+	EXPECT_LT(history.delta_bytes(), 1000 * sizeof(int));
+
+	ASSERT_TRUE(history.rollback(1));
+	EXPECT_EQ(registry.get_component<int>(entities[1]), 100);
+	EXPECT_FALSE(registry.is_enabled(entities[5]));
+
+	ASSERT_TRUE(history.rollback(1));
+	EXPECT_EQ(registry.get_component<int>(entities[1]), 1);
+	EXPECT_EQ(registry.get_component<velocity_t>(entities[2]).x, 1.0f);
+	EXPECT_TRUE(registry.is_enabled(entities[5]));
+
+	// Restored world can still be changed structurally
+	EXPECT_EQ(registry.get_entity(), spawned);
+	registry.remove_component<int>(entities[3]);
+	EXPECT_EQ(registry.get_component<int>(entities[999]), 999);
+}
+
+TEST(snapshot, rollback_after_compact_rebinds_entities) {
+	registry_t registry;
+	register_components(registry);
+
+	std::vector<entity_value_t> entities = populate(registry, 10);
+
+	rollback_buffer_t history(registry, 4);
+
+	ASSERT_TRUE(history.checkpoint());
+
+	for (entity_value_t entity : entities) {
+		registry.remove_component<velocity_t>(entity);
+	}
+
+	ASSERT_TRUE(history.checkpoint());
+
+	// Archetype entities were in at the first checkpoint is deleted, then recreated by rollback
+	EXPECT_GT(registry.compact(), 0);
+	ASSERT_TRUE(history.rollback(1));
+
+	for (int i = 0; i < 10; i++) {
+		EXPECT_EQ(registry.get_component<int>(entities[i]), i);
+		EXPECT_EQ(registry.get_component<velocity_t>(entities[i]).x, 0.5f * i);
+	}
+
+	registry.remove_component<velocity_t>(entities[3]);
+
+	EXPECT_EQ(registry.get_component<int>(entities[3]), 3);
+}
+
+TEST(snapshot, rollback_removes_prefabs_created_after_checkpoint) {
+	registry_t registry;
+	register_components(registry);
+
+	populate(registry, 10);
+
+	rollback_buffer_t history(registry, 4);
+
+	ASSERT_TRUE(history.checkpoint());
+
+	entity_value_t prefab = registry.create_prefab<int, velocity_t>(7, velocity_t{ 1.0f, 1.0f });
+
+	ASSERT_TRUE(history.checkpoint());
+	ASSERT_TRUE(history.rollback(1));
+
+	for (const archetype_memory_t& storage : registry.memory_report().prefabs) {
+		EXPECT_EQ(storage.rows, 0);
+	}
+
+	// Id of the prefab is free again, and reusing it gives an ordinary entity
+	entity_value_t reused = registry.get_entity();
+	EXPECT_EQ(reused, prefab);
+
+	registry.push_component<int>(reused, 4);
+
+	EXPECT_EQ(registry.get_component<int>(reused), 4);
+	EXPECT_TRUE(registry.instantiate(reused, 1).empty());
+}
+
+TEST(snapshot, rollback_restores_prefab_components) {
+	registry_t registry;
+	register_components(registry);
+
+	entity_value_t prefab = registry.create_prefab<int, velocity_t>(7, velocity_t{ 1.0f, 1.0f });
+
+	rollback_buffer_t history(registry, 4);
+
+	ASSERT_TRUE(history.checkpoint());
+
+	registry.get_component<int>(prefab) = 8;
+
+	ASSERT_TRUE(history.checkpoint());
+	ASSERT_TRUE(history.rollback(1));
+
+	EXPECT_EQ(registry.get_component<int>(prefab), 7);
+
+	std::vector<entity_value_t> instances = registry.instantiate(prefab, 2);
+
+	ASSERT_EQ(instances.size(), 2);
+	EXPECT_EQ(registry.get_component<int>(instances[1]), 7);
+}
+
+TEST(snapshot, rollback_rejects_non_trivial_components) {
+	registry_t registry;
+	register_components(registry);
+
+	registry.push_component<tag_t>(registry.get_entity(), tag_t{ "tag" });
+
+	rollback_buffer_t history(registry, 2);
+
+	EXPECT_FALSE(history.checkpoint());
+	EXPECT_EQ(history.size(), 0);
+}